@@ -0,0 +1,156 @@
+#ifndef __BIQUAD_FILTER_HPP__
+#define __BIQUAD_FILTER_HPP__
+
+#include "cmath"
+#include "cstdint"
+
+// fixed-point cascade of second-order IIR sections (direct form I), independent of the target platform;
+// samples are plain int32_t values of any precision, coefficients are expressed in Q29 (range [-4, 4))
+// and products are accumulated in 64 bits; the quantization error of each output is fed back into the
+// next accumulation (first-order error feedback), which removes the dead band and limit cycles that
+// otherwise show up at low cutoff frequencies, where poles lie very close to the unit circle
+
+class BiquadFilter
+{
+public:
+    static constexpr int COEFF_PRECISION = 29;
+    static constexpr int MAX_SECTIONS = 3;
+
+    // transfer function (b0 + b1*z^-1 + b2*z^-2) / (1 + a1*z^-1 + a2*z^-2)
+    struct section
+    {
+        int32_t b0, b1, b2, a1, a2;
+    };
+
+    struct coefficients
+    {
+        section sections[MAX_SECTIONS];
+        uint8_t count; // zero: passthrough
+
+        // exponential moving average: y += factor * (x - y)
+        bool addFirstOrder(double factor);
+
+        // bilinear transform with prewarping, frequencies in the same units as the sampling rate
+        bool addLowPass(double cutOff, double samplingRate, double q);
+        bool addNotch(double frequency, double samplingRate, double q);
+
+    private:
+        // b1 is derived from the remaining coefficients, see below
+        bool add(double b0, double b2, double a1, double a2);
+    };
+
+    // quality factors of the sections of Butterworth filters
+    static constexpr double BUTTERWORTH_2_Q = 0.70710678;
+    static constexpr double BUTTERWORTH_4_Q1 = 0.54119610;
+    static constexpr double BUTTERWORTH_4_Q2 = 1.30656296;
+
+    // sets all delayed samples as if the input had been constant and equal to value for a long time,
+    // which is the steady state of any section with unity DC gain (all of the above)
+    void reset(int32_t value);
+
+    int32_t process(const coefficients & coeffs, int32_t x);
+
+private:
+    struct state
+    {
+        int32_t x1, x2, y1, y2;
+        int32_t error; // remainder of the previous output, in [0, 2^COEFF_PRECISION)
+    };
+
+    state states[MAX_SECTIONS] {};
+};
+
+inline bool BiquadFilter::coefficients::addFirstOrder(double factor)
+{
+    return add(factor, 0.0, factor - 1.0, 0.0);
+}
+
+inline bool BiquadFilter::coefficients::addLowPass(double cutOff, double samplingRate, double q)
+{
+    const double w0 = 2.0 * M_PI * cutOff / samplingRate;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double a0 = 1.0 + alpha;
+    const double s = std::sin(w0 / 2.0);
+    const double b0 = (s * s) / a0; // (1 - cos(w0)) / 2, but more accurate at low frequencies
+
+    return add(b0, b0, (-2.0 * std::cos(w0)) / a0, (1.0 - alpha) / a0);
+}
+
+inline bool BiquadFilter::coefficients::addNotch(double frequency, double samplingRate, double q)
+{
+    const double w0 = 2.0 * M_PI * frequency / samplingRate;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double a0 = 1.0 + alpha;
+    const double a1 = (-2.0 * std::cos(w0)) / a0;
+
+    return add(1.0 / a0, 1.0 / a0, a1, (1.0 - alpha) / a0);
+}
+
+inline bool BiquadFilter::coefficients::add(double b0, double b2, double a1, double a2)
+{
+    if (count == MAX_SECTIONS)
+    {
+        return false;
+    }
+
+    const double scale = static_cast<double>(1L << COEFF_PRECISION);
+    section & sec = sections[count];
+
+    sec.b0 = static_cast<int32_t>(std::lround(b0 * scale));
+    sec.b2 = static_cast<int32_t>(std::lround(b2 * scale));
+    sec.a1 = static_cast<int32_t>(std::lround(a1 * scale));
+    sec.a2 = static_cast<int32_t>(std::lround(a2 * scale));
+
+    // the quantized b1 absorbs all rounding errors so that the DC gain is exactly one, otherwise tiny
+    // numerator coefficients at low cutoff frequencies would cause noticeable gain errors
+    sec.b1 = ((1L << COEFF_PRECISION) + sec.a1 + sec.a2) - sec.b0 - sec.b2;
+
+    count++;
+    return true;
+}
+
+inline void BiquadFilter::reset(int32_t value)
+{
+    for (auto & s : states)
+    {
+        s.x1 = s.x2 = s.y1 = s.y2 = value;
+        s.error = 0;
+    }
+}
+
+inline int32_t BiquadFilter::process(const coefficients & coeffs, int32_t x)
+{
+    for (int i = 0; i < coeffs.count; i++)
+    {
+        const section & c = coeffs.sections[i];
+        state & s = states[i];
+
+        int64_t acc = s.error;
+
+        acc += static_cast<int64_t>(c.b0) * x;
+        acc += static_cast<int64_t>(c.b1) * s.x1;
+        acc += static_cast<int64_t>(c.b2) * s.x2;
+        acc -= static_cast<int64_t>(c.a1) * s.y1;
+        acc -= static_cast<int64_t>(c.a2) * s.y2;
+
+        int64_t y = acc >> COEFF_PRECISION; // floor
+        s.error = static_cast<int32_t>(acc - (y << COEFF_PRECISION));
+
+        if (y > INT32_MAX || y < INT32_MIN)
+        {
+            y = y > INT32_MAX ? INT32_MAX : INT32_MIN; // saturate, e.g. on overshoot close to full range
+            s.error = 0;
+        }
+
+        s.x2 = s.x1;
+        s.x1 = x;
+        s.y2 = s.y1;
+        s.y1 = static_cast<int32_t>(y);
+
+        x = s.y1; // input of the next section
+    }
+
+    return x;
+}
+
+#endif // __BIQUAD_FILTER_HPP__
@@ -0,0 +1,71 @@
+#ifndef __CALIBRATION_STORAGE_HPP__
+#define __CALIBRATION_STORAGE_HPP__
+
+#include "cstddef"
+#include "cstdint"
+
+// persistent cache of the sensor calibration, so that initialization does not need to wait for the whole
+// EEPROM to be streamed by the sensor; see FlashCalibrationStorage.hpp for on-chip flash (target builds)
+// and FileCalibrationStorage.hpp for a regular file (host builds)
+
+struct calibration_record
+{
+    static constexpr uint32_t MAGIC = 0x4A523343; // "JR3C"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t key; // CRC-32 of the EEPROM image, identifies the sensor
+    uint8_t eeprom[256];
+    int32_t coefficients[36]; // parsed calibration matrix, raw fixed-point values
+    uint16_t fullScales[6];
+    uint32_t checksum; // CRC-32 of all preceding fields
+
+    // fills in the header, key and checksum fields, call after filling in the payload
+    void seal()
+    {
+        magic = MAGIC;
+        version = VERSION;
+        key = crc32(eeprom, sizeof(eeprom));
+        checksum = crc32(this, offsetof(calibration_record, checksum));
+    }
+
+    // false on erased or corrupted storage, or on a layout change
+    bool isValid() const
+    {
+        return magic == MAGIC && version == VERSION
+            && key == crc32(eeprom, sizeof(eeprom))
+            && checksum == crc32(this, offsetof(calibration_record, checksum));
+    }
+
+    static uint32_t crc32(const void * data, std::size_t size)
+    {
+        // bitwise, reflected, polynomial 0xEDB88320; small and fast enough for a few hundred bytes
+        const uint8_t * bytes = static_cast<const uint8_t *>(data);
+        uint32_t crc = 0xFFFFFFFF;
+
+        for (std::size_t i = 0; i < size; i++)
+        {
+            crc ^= bytes[i];
+
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0U - (crc & 1U)));
+            }
+        }
+
+        return ~crc;
+    }
+};
+
+class CalibrationStorage
+{
+public:
+    virtual ~CalibrationStorage() = default;
+
+    // the returned record should be checked with calibration_record::isValid()
+    virtual bool load(calibration_record & record) = 0;
+    virtual bool store(const calibration_record & record) = 0;
+};
+
+#endif // __CALIBRATION_STORAGE_HPP__
@@ -0,0 +1,48 @@
+#ifndef __FILE_CALIBRATION_STORAGE_HPP__
+#define __FILE_CALIBRATION_STORAGE_HPP__
+
+#include "cstdio"
+#include "CalibrationStorage.hpp"
+
+// calibration cache backed by a regular file, meant for host builds (or for targets with a mounted
+// file system); the path is not copied, it must outlive this object
+
+class FileCalibrationStorage : public CalibrationStorage
+{
+public:
+    explicit FileCalibrationStorage(const char * path)
+        : path(path)
+    {}
+
+    bool load(calibration_record & record) override
+    {
+        std::FILE * file = std::fopen(path, "rb");
+
+        if (!file)
+        {
+            return false;
+        }
+
+        const bool ok = std::fread(&record, sizeof(record), 1, file) == 1;
+        std::fclose(file);
+        return ok;
+    }
+
+    bool store(const calibration_record & record) override
+    {
+        std::FILE * file = std::fopen(path, "wb");
+
+        if (!file)
+        {
+            return false;
+        }
+
+        const bool ok = std::fwrite(&record, sizeof(record), 1, file) == 1;
+        return std::fclose(file) == 0 && ok;
+    }
+
+private:
+    const char * path;
+};
+
+#endif // __FILE_CALIBRATION_STORAGE_HPP__
@@ -0,0 +1,64 @@
+#ifndef __FLASH_CALIBRATION_STORAGE_HPP__
+#define __FLASH_CALIBRATION_STORAGE_HPP__
+
+#include "mbed.h"
+#include "CalibrationStorage.hpp"
+
+#if DEVICE_FLASH
+
+// calibration cache stored in the last sector of the on-chip flash (32 KB on the LPC1768), make sure
+// that the application image does not grow that far, e.g. by setting "target.restrict_size" in
+// mbed_app.json; the sector is only rewritten when the cached calibration does not match the sensor
+
+class FlashCalibrationStorage : public CalibrationStorage
+{
+public:
+    bool load(calibration_record & record) override
+    {
+        if (flash.init() != 0)
+        {
+            return false;
+        }
+
+        const bool ok = flash.read(&record, getAddress(), sizeof(record)) == 0;
+        flash.deinit();
+        return ok;
+    }
+
+    bool store(const calibration_record & record) override
+    {
+        if (flash.init() != 0)
+        {
+            return false;
+        }
+
+        const uint32_t address = getAddress();
+        const uint32_t pageSize = flash.get_page_size();
+        const uint32_t size = ((sizeof(record) + pageSize - 1) / pageSize) * pageSize; // whole pages only
+
+        // programming requires a buffer in RAM, padded with the erased value
+        uint8_t * buffer = new uint8_t[size];
+        memset(buffer, 0xFF, size);
+        memcpy(buffer, &record, sizeof(record));
+
+        const bool ok = flash.erase(address, flash.get_sector_size(address)) == 0
+                     && flash.program(buffer, address, size) == 0;
+
+        delete[] buffer;
+        flash.deinit();
+        return ok;
+    }
+
+private:
+    uint32_t getAddress() const
+    {
+        const uint32_t end = flash.get_flash_start() + flash.get_flash_size();
+        return end - flash.get_sector_size(end - 1);
+    }
+
+    mbed::FlashIAP flash;
+};
+
+#endif // DEVICE_FLASH
+
+#endif // __FLASH_CALIBRATION_STORAGE_HPP__
@@ -14,8 +14,20 @@ namespace
 }
 #endif
 
-Jr3Controller::Jr3Controller(mbed::Callback<uint32_t()> cb)
-    : readerCallback(cb)
+namespace
+{
+    // rounds to nearest, halfway cases away from zero
+    inline int32_t divideRounded(int64_t sum, int32_t divisor)
+    {
+        return static_cast<int32_t>((sum + (sum < 0 ? -divisor : divisor) / 2) / divisor);
+    }
+}
+
+constexpr std::chrono::milliseconds Jr3Controller::DEFAULT_INITIALIZATION_TIMEOUT; // odr-used as default argument
+
+Jr3Controller::Jr3Controller(mbed::Callback<uint32_t()> cb, mbed::Callback<uint32_t()> falseStartPulsesCb)
+    : readerCallback(cb),
+      falseStartPulsesCallback(falseStartPulsesCb)
 {}
 
 void Jr3Controller::startSync(uint16_t cutOffFrequency)
@@ -26,7 +38,8 @@ void Jr3Controller::startSync(uint16_t cutOffFrequency)
     startSensorThread();
 }
 
-void Jr3Controller::startAsync(mbed::Callback<void(uint16_t *)> cb, uint16_t cutOffFrequency, uint32_t periodUs)
+void Jr3Controller::startAsync(mbed::Callback<void(uint16_t *, uint16_t)> cb, uint16_t cutOffFrequency, uint32_t periodUs,
+                               overrun_policy policy, uint16_t batchSize)
 {
     CHECK_STATE();
 
@@ -39,10 +52,24 @@ void Jr3Controller::startAsync(mbed::Callback<void(uint16_t *)> cb, uint16_t cut
 
     printf("using a period of %lu us\n", periodUs);
 
+    if (batchSize == 0 || batchSize > MAX_ASYNC_BATCH)
+    {
+        batchSize = batchSize == 0 ? 1 : MAX_ASYNC_BATCH;
+    }
+
+    printf("using a batch size of %d samples\n", batchSize);
+
     mutex.lock();
     asyncPeriodUs = std::chrono::microseconds(periodUs);
+    asyncOverrunPolicy = policy;
+    asyncBatchSize = batchSize;
     mutex.unlock();
 
+    if (asyncThread)
+    {
+        asyncFlags.set(ASYNC_SETTINGS_CHANGED);
+    }
+
     setFilter(cutOffFrequency);
     startSensorThread();
     startAsyncThread();
@@ -52,12 +79,42 @@ void Jr3Controller::startSensorThread()
 {
     if (!sensorThread)
     {
-        mutex.lock();
         sensorStopRequested = false;
-        mutex.unlock();
+        history.clear();
+        historyAttached = false;
+
+        completedFrameSets = 0;
+        discardedFrameSets = 0;
+        skippedChannels = 0;
+        historyOverruns = 0;
+        readTimeouts = 0;
+        recoveries = 0;
+        historyHighWater = 0;
+        captureOverruns = 0;
+        captureHighWater = 0;
+        sensorStale = false;
+        falseStartPulsesBaseline = falseStartPulsesCallback ? falseStartPulsesCallback() : 0; // no reader thread yet
+        falseStartPulses = 0;
+        readerFrames = 0;
+
+        if (pipelining)
+        {
+            captureQueue.clear();
+            captureFlags.clear(FRAMES_CAPTURED);
+
+            // highest priority, the sensor thread only runs while the reader blocks waiting for the next frame
+            captureThread = new rtos::Thread(osPriorityRealtime);
+            captureThread->start({this, &Jr3Controller::doCaptureWork});
+        }
 
         sensorThread = new rtos::Thread(osPriorityNormal);
         sensorThread->start({this, &Jr3Controller::doSensorWork});
+
+        // above the sensor thread, which never yields with a busy-waiting reader; a recomputation preempts it for
+        // a few frame sets (discarded and accounted as such), which only happens if the link clock drifts
+        filterFlags.clear(PERIOD_CHANGED | FILTER_THREAD_STOP);
+        filterThread = new rtos::Thread(osPriorityAboveNormal, FILTER_THREAD_STACK_SIZE);
+        filterThread->start({this, &Jr3Controller::doFilterWork});
     }
 }
 
@@ -65,11 +122,10 @@ void Jr3Controller::startAsyncThread()
 {
     if (!asyncThread)
     {
-        mutex.lock();
-        asyncStopRequested = false;
-        mutex.unlock();
+        asyncFlags.clear(BATCH_READY | ASYNC_SETTINGS_CHANGED | ASYNC_THREAD_STOP);
+        missedDeadlines = 0;
 
-        // increased priority, see AccurateWaiter::wait_for
+        // increased priority, so that a complete batch is delivered right away even if the sensor thread busy-waits
         asyncThread = new rtos::Thread(osPriorityAboveNormal);
         asyncThread->start({this, &Jr3Controller::doAsyncWork});
     }
@@ -86,18 +142,27 @@ void Jr3Controller::stopSensorThread()
 {
     if (sensorThread)
     {
-        mutex.lock();
         sensorStopRequested = true;
-        mutex.unlock();
 
         sensorThread->join();
         delete sensorThread;
         sensorThread = nullptr;
 
-        mutex.lock();
-        memset((void*)shared, 0, sizeof(shared));
-        frameCounter = 0;
-        mutex.unlock();
+        filterFlags.set(FILTER_THREAD_STOP);
+        filterThread->join();
+        delete filterThread;
+        filterThread = nullptr;
+
+        if (captureThread)
+        {
+            // joined last, since the sensor thread checks this pointer (see nextFrame())
+            captureThread->join();
+            delete captureThread;
+            captureThread = nullptr;
+        }
+
+        // the writer is gone, it is safe to publish from here
+        latest.store({});
     }
 }
 
@@ -105,23 +170,21 @@ void Jr3Controller::stopAsyncThread()
 {
     if (asyncThread)
     {
-        mutex.lock();
-        asyncStopRequested = true;
-        mutex.unlock();
+        asyncFlags.set(ASYNC_THREAD_STOP);
 
         asyncThread->join();
         delete asyncThread;
         asyncThread = nullptr;
+
+        // the writer is gone, it is safe to publish from here; the sensor thread stops taking samples
+        asyncGrid.store({});
     }
 }
 
 void Jr3Controller::calibrate()
 {
     CHECK_STATE();
-
-    mutex.lock();
     zeroOffsets = true;
-    mutex.unlock();
 }
 
 void Jr3Controller::setFilter(uint16_t cutOffFrequency)
@@ -133,30 +196,183 @@ void Jr3Controller::setFilter(uint16_t cutOffFrequency)
 
     mutex.lock();
 
-    if (cutOffFrequency != 0)
+    for (auto & settings : filterSettings)
     {
-        // https://w.wiki/7Er6
-        smoothingFactor = samplingPeriod / (samplingPeriod + 1.0f / (2.0f * M_PI * cutOffFrequency * 0.01f));
+        settings.cutOffFrequency = cutOffFrequency;
     }
-    else
+
+    updateFilters();
+    mutex.unlock();
+}
+
+void Jr3Controller::setFilter(uint16_t cutOffFrequency, filter_type type, uint16_t notchFrequency)
+{
+    CHECK_STATE();
+
+    // the input frequencies are expressed in [0.01*Hz]
+    printf("setting new filter on all axes: type %d, cutoff %.1f Hz, notch %.1f Hz\n",
+           type, cutOffFrequency * 0.01f, notchFrequency * 0.01f);
+
+    mutex.lock();
+
+    for (auto & settings : filterSettings)
+    {
+        settings = {cutOffFrequency, type, notchFrequency};
+    }
+
+    updateFilters();
+    mutex.unlock();
+}
+
+void Jr3Controller::setAxisFilter(uint8_t axis, uint16_t cutOffFrequency, filter_type type, uint16_t notchFrequency)
+{
+    CHECK_STATE();
+
+    if (axis >= 6)
+    {
+        printf("illegal axis: %d\n", axis);
+        return;
+    }
+
+    // the input frequencies are expressed in [0.01*Hz]
+    printf("setting new filter on axis %d: type %d, cutoff %.1f Hz, notch %.1f Hz\n",
+           axis, type, cutOffFrequency * 0.01f, notchFrequency * 0.01f);
+
+    mutex.lock();
+    filterSettings[axis] = {cutOffFrequency, type, notchFrequency};
+    updateFilters();
+    mutex.unlock();
+}
+
+void Jr3Controller::updateFilters()
+{
+    // called with the mutex held, which serializes writers; the sensor thread is the only reader and never waits
+    const double period = measuredSamplingPeriod;
+    const double samplingRate = 1.0 / period;
+    filter_bank bank {};
+
+    for (int i = 0; i < 6; i++)
+    {
+        const filter_settings & settings = filterSettings[i];
+        BiquadFilter::coefficients & coeffs = bank.axes[i];
+        const double cutOff = settings.cutOffFrequency * 0.01;
+
+        if (settings.cutOffFrequency != 0)
+        {
+            switch (settings.type)
+            {
+            case FIRST_ORDER:
+                // https://w.wiki/7Er6
+                coeffs.addFirstOrder(period / (period + 1.0 / (2.0 * M_PI * cutOff)));
+                break;
+            case BUTTERWORTH_2:
+                coeffs.addLowPass(cutOff, samplingRate, BiquadFilter::BUTTERWORTH_2_Q);
+                break;
+            case BUTTERWORTH_4:
+                coeffs.addLowPass(cutOff, samplingRate, BiquadFilter::BUTTERWORTH_4_Q1);
+                coeffs.addLowPass(cutOff, samplingRate, BiquadFilter::BUTTERWORTH_4_Q2);
+                break;
+            }
+        }
+
+        if (settings.notchFrequency != 0)
+        {
+            coeffs.addNotch(settings.notchFrequency * 0.01, samplingRate, NOTCH_QUALITY);
+        }
+    }
+
+    filterPeriod = period;
+    filterCoeffs.store(bank);
+}
+
+void Jr3Controller::doFilterWork()
+{
+    while (true)
+    {
+        const uint32_t flags = filterFlags.wait_any(PERIOD_CHANGED | FILTER_THREAD_STOP);
+
+        if ((flags & osFlagsError) != 0 || (flags & FILTER_THREAD_STOP) != 0)
+        {
+            break;
+        }
+
+        const float period = measuredSamplingPeriod;
+
+        mutex.lock();
+
+        // the filters might have been updated in the meantime, e.g. by setFilter()
+        if (fabsf(period - filterPeriod) > PERIOD_TOLERANCE * filterPeriod)
+        {
+            updateFilters();
+        }
+
+        mutex.unlock();
+    }
+}
+
+void Jr3Controller::setDecouplingMode(decoupling_mode mode)
+{
+    CHECK_STATE();
+
+    if (sensorThread)
+    {
+        printf("decoupling mode will be applied on next start\n");
+    }
+
+    decouplingMode = mode;
+}
+
+void Jr3Controller::setPipelining(bool enable)
+{
+    CHECK_STATE();
+
+    if (sensorThread)
+    {
+        printf("pipelining will be applied on next start\n");
+    }
+
+    pipelining = enable;
+}
+
+void Jr3Controller::setDecimation(uint16_t factor)
+{
+    CHECK_STATE();
+
+    if (factor == 0)
     {
-        smoothingFactor = 1.0f; // unfiltered
+        factor = 1;
     }
 
+    printf("setting new decimation factor: %d (%.1f Hz)\n", factor, 1.0f / (measuredSamplingPeriod * factor));
+    decimationFactor = factor;
+}
+
+void Jr3Controller::setInterpolation(bool enable)
+{
+    CHECK_STATE();
+    printf("%s interpolation of async samples\n", enable ? "enabling" : "disabling");
+
+    mutex.lock();
+    asyncInterpolation = enable;
     mutex.unlock();
 
-    printf("smoothing factor: %0.6f\n", static_cast<float>(smoothingFactor));
+    if (asyncThread)
+    {
+        asyncFlags.set(ASYNC_SETTINGS_CHANGED);
+    }
 }
 
 void Jr3Controller::getFullScales(uint16_t * data) const
 {
     CHECK_STATE();
+    mutex.lock();
     memcpy(data, fullScales, sizeof(fullScales));
+    mutex.unlock();
 }
 
 bool Jr3Controller::acquire(uint16_t * data) const
 {
-    if (state == READY && sensorThread)
+    if (state == READY && sensorThread && !sensorStale)
     {
         acquireInternal(data);
         return true;
@@ -165,66 +381,415 @@ bool Jr3Controller::acquire(uint16_t * data) const
     return false;
 }
 
+bool Jr3Controller::acquireExtended(int32_t * data) const
+{
+    if (state == READY && sensorThread && !sensorStale)
+    {
+        const wrench_sample sample = latest.load().current;
+        fixed_t values[6];
+
+        decoupleSample(sample, values);
+
+        for (int i = 0; i < 6; i++)
+        {
+            data[i] = jr3FromFixedPointExtended(values[i]);
+        }
+
+        data[6] = sample.frameCounter;
+        return true;
+    }
+
+    return false;
+}
+
+std::size_t Jr3Controller::acquireBatch(uint16_t * buffer, std::size_t maxSamples)
+{
+    // single consumer: must not be called concurrently from several threads, nor while starting or
+    // stopping; each sample occupies 7 elements in the buffer, same layout as in acquire()
+    if (state != READY || !sensorThread)
+    {
+        return 0;
+    }
+
+    // recording starts on the first call, so that the history neither fills up with stale samples nor
+    // counts overruns while nobody is draining it
+    historyAttached = true;
+
+    wrench_sample sample;
+    std::size_t n = 0;
+
+    while (n < maxSamples && history.pop(sample))
+    {
+        decodeSample(sample, buffer);
+        buffer += 7;
+        n++;
+    }
+
+    return n;
+}
+
 Jr3Controller::jr3_state Jr3Controller::getState() const
 {
     return state;
 }
 
+bool Jr3Controller::isStale() const
+{
+    return sensorStale;
+}
+
+uint32_t Jr3Controller::getMissedDeadlines() const
+{
+    return missedDeadlines;
+}
+
+void Jr3Controller::onSystemFrequencyChange(uint32_t hz)
+{
+    // called from the thread that changed the clock, the sensor thread takes care of the rest
+    printf("system frequency changed to %lu Hz\n", hz);
+    timingReset = true;
+}
+
+float Jr3Controller::getSamplingPeriod() const
+{
+    return measuredSamplingPeriod;
+}
+
+Jr3Controller::acquisition_stats Jr3Controller::getAcquisitionStats() const
+{
+    acquisition_stats stats;
+
+    stats.completedFrameSets = completedFrameSets;
+    stats.discardedFrameSets = discardedFrameSets;
+    stats.skippedChannels = skippedChannels;
+    stats.falseStartPulses = falseStartPulses; // sampled by the reader thread, see readFrame()
+    stats.historyOverruns = historyOverruns;
+    stats.readTimeouts = readTimeouts;
+    stats.recoveries = recoveries;
+    stats.captureOverruns = captureOverruns;
+    stats.captureQueueDepth = captureQueue.size();
+    stats.captureQueueHighWater = captureHighWater;
+    stats.historyDepth = history.size();
+    stats.historyHighWater = historyHighWater;
+
+    return stats;
+}
+
+Jr3Controller::initialization_stats Jr3Controller::getInitializationStats() const
+{
+    return initializationStats;
+}
+
+bool Jr3Controller::getPipelineStats(profiling_stats & stats) const
+{
+#if JR3_PROFILING
+    stats = pipelineStats.load();
+    return true;
+#else
+    (void)stats;
+    return false; // compiled out
+#endif
+}
+
+void Jr3Controller::setCalibrationStorage(CalibrationStorage * storage)
+{
+    calibrationStorage = storage;
+}
+
 void Jr3Controller::initialize()
 {
+    if (state != INITIALIZING)
+    {
+        startInitialization(DEFAULT_INITIALIZATION_TIMEOUT);
+    }
+
+    // bounded by the timeout, the background thread gives up on its own
+    initializationThread->join();
+}
+
+void Jr3Controller::startInitialization(std::chrono::milliseconds timeout)
+{
+    if (state == INITIALIZING)
+    {
+        printf("initialization already in progress\n");
+        return;
+    }
+
     // in case a re-initialization was requested
     stopAsyncThread();
     stopSensorThread();
 
-    state = UNINITIALIZED;
+    if (initializationThread)
+    {
+        // finished already, see doInitialization()
+        initializationThread->join();
+        delete initializationThread;
+        initializationThread = nullptr;
+    }
+
+    initializationTimeout = timeout;
+    initializationProgress = 0;
+    state = INITIALIZING;
+
+    // kept until the next call, since a thread can not delete itself; hence a small, explicit stack
+    initializationThread = new rtos::Thread(osPriorityNormal, INITIALIZATION_STACK_SIZE);
+    initializationThread->start({this, &Jr3Controller::doInitialization});
+}
+
+uint8_t Jr3Controller::getInitializationProgress() const
+{
+    return (initializationProgress * 100) / 256;
+}
+
+void Jr3Controller::doInitialization()
+{
+    // supervisor: the reader callback might block forever if the sensor is not connected, hence the
+    // actual work is carried out by a separate thread that gets terminated on timeout; the calibration
+    // cache is only accessed from here, since killing a thread that holds a lock (flash, heap, stdio)
+    // would leave it locked forever
+    initializationFlags.clear(INITIALIZATION_DONE);
+
+    const uint32_t start = us_ticker_read();
+
+    initialization_context context {};
+    context.cached = calibrationStorage && calibrationStorage->load(context.record) && context.record.isValid();
+    context.stats.storageUs = us_ticker_read() - start;
+    initializationContext = &context;
+
+    rtos::Thread worker(osPriorityNormal, INITIALIZATION_WORKER_STACK_SIZE);
+    worker.start({this, &Jr3Controller::doInitializationWork});
+
+    const uint32_t flags = initializationFlags.wait_any_for(INITIALIZATION_DONE, initializationTimeout);
+
+    if ((flags & osFlagsError) != 0)
+    {
+        // the worker only calls the reader, it neither prints anything nor holds any lock
+        worker.terminate();
+        initializationContext = nullptr;
+        printf("initialization timed out after %d ms (%d%% done)\n",
+               static_cast<int>(initializationTimeout.count()), getInitializationProgress());
+        state = FAILED;
+        return;
+    }
+
+    worker.join();
+    initializationContext = nullptr;
+
+    initialization_stats & stats = context.stats;
+    calibration_record & record = context.record;
+    bool stored = true;
+
+    if (calibrationStorage && !stats.cacheHit)
+    {
+        const uint32_t mark = us_ticker_read();
+
+        for (int i = 0; i < 36; i++)
+        {
+            record.coefficients[i] = calibrationCoeffs[i].intValue;
+        }
+
+        memcpy(record.fullScales, fullScales, sizeof(fullScales));
+        record.seal();
+
+        stored = calibrationStorage->store(record);
+        stats.storageUs += us_ticker_read() - mark;
+    }
+
+    stats.totalUs = us_ticker_read() - start;
+    initializationStats = stats;
+
+    if (stats.cacheHit)
+    {
+        printf("\nusing cached calibration (key: %08lX)\n", record.key);
+    }
+    else if (context.cached)
+    {
+        printf("\ncached calibration does not match the sensor\n");
+    }
+
+    if (!stored)
+    {
+        printf("\nunable to store calibration in cache\n");
+    }
+
+    printCalibration(record.eeprom);
+
+    printf("\n\ninitialization phases [us]: verification %lu, collection %lu (%d frames), storage %lu, total %lu",
+           stats.verificationUs, stats.collectionUs, stats.calibrationFrames, stats.storageUs, stats.totalUs);
+
+    printf("\n\ninitialization done\n\n");
+
+    state = READY;
+}
+
+void Jr3Controller::doInitializationWork()
+{
+    // may be terminated at any point before signalling completion, see doInitialization()
+    initialization_context & context = *initializationContext;
+    initialization_stats & stats = context.stats;
+    uint32_t mark = us_ticker_read();
+
+    // elapsed time since the previous call, in [us]
+    auto lap = [&mark]()
+    {
+        const uint32_t now = us_ticker_read();
+        const uint32_t elapsed = now - mark;
+        mark = now;
+        return elapsed;
+    };
+
+    stats.cacheHit = context.cached && verifyCalibration(context.record.eeprom);
+    stats.verificationUs = lap();
+
+    if (stats.cacheHit)
+    {
+        for (int i = 0; i < 36; i++)
+        {
+            calibrationCoeffs[i].intValue = context.record.coefficients[i];
+        }
+
+        memcpy(fullScales, context.record.fullScales, sizeof(fullScales));
+    }
+    else
+    {
+        stats.calibrationFrames = collectCalibration(context.record.eeprom);
+        stats.collectionUs = lap();
+
+        jr3ParseCalibration(context.record.eeprom, calibrationCoeffs, fullScales);
+    }
+
+    calibration_matrix matrix;
+    memcpy(matrix.values, calibrationCoeffs, sizeof(calibrationCoeffs));
+    sharedCalibration.store(matrix); // no sensor thread is running
+
+    initializationProgress = 256;
+    initializationFlags.set(INITIALIZATION_DONE);
+}
+
+bool Jr3Controller::verifyCalibration(const uint8_t * eeprom)
+{
+    // compare EEPROM bytes streamed by the sensor against the cached image until every byte of the calibration
+    // matrix and full scales has matched, since that is what the cached record holds in parsed form; any
+    // mismatch, in this region or elsewhere, fails right away; a few lost calibration frames only delay the
+    // outcome until the next EEPROM cycle, give up if the region is still not covered after two of them
+    uint32_t covered[256 / 32] {}; // one bit per address
+    int remaining = CALIBRATION_REGION_END - CALIBRATION_REGION_START;
+    int frames = 0;
+
+    while (remaining > 0)
+    {
+        uint32_t frame = readerCallback();
+
+        if ((frame & 0x000F0000) >> 16 == CALIBRATION)
+        {
+            uint8_t address = (frame & 0x0000FF00) >> 8;
+            uint8_t value = frame & 0x000000FF;
+            const uint32_t bit = 1UL << (address % 32);
+
+            if (eeprom[address] != value || ++frames > 2 * 256)
+            {
+                return false;
+            }
+
+            if (address >= CALIBRATION_REGION_START && address < CALIBRATION_REGION_END && (covered[address / 32] & bit) == 0)
+            {
+                covered[address / 32] |= bit;
+                remaining--;
+                initializationProgress = CALIBRATION_REGION_END - CALIBRATION_REGION_START - remaining;
+            }
+        }
+    }
+
+    return true;
+}
 
-    uint8_t calibration[256];
-    uint8_t calibrationIndex = 0;
+uint16_t Jr3Controller::collectCalibration(uint8_t * eeprom, bool interruptible)
+{
+    // accept bytes in any order, so that a lost calibration frame only needs to be picked up on the
+    // next EEPROM cycle instead of stalling the whole scan; returns the number of calibration frames read,
+    // or zero if interrupted by a read timeout or a stop request
+    uint32_t collected[256 / 32] {}; // one bit per address
     int calibrationCounter = 0;
+    uint16_t frames = 0;
 
     while (calibrationCounter < 256)
     {
-        uint32_t frame = readerCallback();
+        uint32_t frame = nextFrame();
+
+        if (interruptible && (frame == JR3_INVALID_FRAME || sensorStopRequested))
+        {
+            return 0;
+        }
 
         if ((frame & 0x000F0000) >> 16 == CALIBRATION)
         {
             uint8_t address = (frame & 0x0000FF00) >> 8;
             uint8_t value = frame & 0x000000FF;
+            const uint32_t bit = 1UL << (address % 32);
 
-            if (calibrationCounter == 0 || address == calibrationIndex)
+            if ((collected[address / 32] & bit) == 0)
             {
-                calibration[address] = value;
-                calibrationIndex = address + 1;
+                eeprom[address] = value;
+                collected[address / 32] |= bit;
                 calibrationCounter++;
+                initializationProgress = calibrationCounter;
             }
+
+            frames++;
         }
     }
 
+    return frames;
+}
+
+bool Jr3Controller::recoverSensor()
+{
+    // called by the sensor thread once frames arrive again after a timeout: the sensor might have been
+    // replaced or power-cycled in the meantime, read the calibration again and apply it if it has changed
+    uint8_t eeprom[256];
+    fixed_t coeffs[36];
+    uint16_t scales[6];
+
+    if (collectCalibration(eeprom, true) == 0)
+    {
+        return false;
+    }
+
+    jr3ParseCalibration(eeprom, coeffs, scales);
+
+    if (memcmp(coeffs, calibrationCoeffs, sizeof(coeffs)) != 0 || memcmp(scales, fullScales, sizeof(scales)) != 0)
+    {
+        printf("sensor calibration has changed, offsets should be zeroed again\n");
+
+        calibration_matrix matrix;
+        memcpy(matrix.values, coeffs, sizeof(coeffs));
+
+        mutex.lock();
+        memcpy(calibrationCoeffs, coeffs, sizeof(coeffs)); // only used by this thread, see decoupleSample()
+        memcpy(fullScales, scales, sizeof(scales));
+        sharedCalibration.store(matrix);
+        mutex.unlock();
+    }
+
+    return true;
+}
+
+void Jr3Controller::printCalibration(const uint8_t * eeprom) const
+{
     printf("\nEEPROM contents:\n\n");
 
     for (int i = 0; i < 256; i += 8)
     {
         printf("[%02X] %02X %02X %02X %02X %02X %02X %02X %02X\n",
                i,
-               calibration[i], calibration[i + 1], calibration[i + 2], calibration[i + 3],
-               calibration[i + 4], calibration[i + 5], calibration[i + 6], calibration[i + 7]);
+               eeprom[i], eeprom[i + 1], eeprom[i + 2], eeprom[i + 3],
+               eeprom[i + 4], eeprom[i + 5], eeprom[i + 6], eeprom[i + 7]);
     }
 
     printf("\ncalibration matrix:\n\n");
 
     for (int i = 0; i < 6; i++)
     {
-        for (int j = 0; j < 6; j++)
-        {
-            uint16_t mantissa;
-            int8_t exponent;
-
-            memcpy(&mantissa, calibration + 10 + (i * 20) + (j * 3), sizeof(uint16_t));
-            memcpy(&exponent, calibration + 12 + (i * 20) + (j * 3), sizeof(int8_t));
-
-            calibrationCoeffs[(i * 6) + j] = jr3ToFixedPoint(mantissa, exponent);
-        }
-
         printf("%0.6f %0.6f %0.6f %0.6f %0.6f %0.6f\n",
                static_cast<float>(calibrationCoeffs[(i * 6)]),
                static_cast<float>(calibrationCoeffs[(i * 6) + 1]),
@@ -238,30 +803,107 @@ void Jr3Controller::initialize()
 
     for (int i = 0; i < 6; i++)
     {
-        uint16_t fullScale;
-        memcpy(&fullScale, calibration + 28 + (i * 20), sizeof(uint16_t));
-        fullScales[i] = fullScale;
-        printf("%d ", fullScale);
+        printf("%d ", fullScales[i]);
     }
-
-    printf("\n\ninitialization done\n\n");
-
-    state = READY;
 }
 
 void Jr3Controller::acquireInternal(uint16_t * data) const
 {
-    fixed_t temp[6];
+    // never blocks, not even while the sensor thread is publishing a new sample
+    decodeSample(latest.load().current, data);
+}
 
-    mutex.lock();
-    memcpy(temp, shared, sizeof(shared));
-    data[6] = frameCounter;
-    mutex.unlock();
+void Jr3Controller::decodeSample(const wrench_sample & sample, uint16_t * data) const
+{
+    fixed_t values[6];
+
+    decoupleSample(sample, values);
 
     for (int i = 0; i < 6; i++)
     {
-        data[i] = jr3FromFixedPoint(temp[i]);
+        data[i] = jr3FromFixedPoint(values[i]);
+    }
+
+    data[6] = sample.frameCounter;
+}
+
+void Jr3Controller::decoupleSample(const wrench_sample & sample, fixed_t * values) const
+{
+    if (sample.raw)
+    {
+        const calibration_matrix matrix = sharedCalibration.load();
+        fixedpoint::multiply_matrix_vector<6, 6>(matrix.values, sample.values, values);
+    }
+    else
+    {
+        memcpy(values, sample.values, sizeof(sample.values));
+    }
+}
+
+uint32_t Jr3Controller::readFrame()
+{
+    // the reader's own counter is not thread-safe, hence it is sampled here (every 256 frames) rather than
+    // by getAcquisitionStats()
+    if (falseStartPulsesCallback && (++readerFrames & 0xFF) == 0)
+    {
+        falseStartPulses = falseStartPulsesCallback() - falseStartPulsesBaseline;
+    }
+
+    return readerCallback();
+}
+
+uint32_t Jr3Controller::nextFrame()
+{
+    if (!captureThread)
+    {
+        return readFrame();
+    }
+
+    uint32_t frame;
+
+    while (!captureQueue.pop(frame))
+    {
+        if (sensorStopRequested)
+        {
+            return JR3_INVALID_FRAME;
+        }
+
+        // signalled once per frame set, the timeout only serves to check the stop request
+        captureFlags.wait_any_for(FRAMES_CAPTURED, 10ms);
+    }
+
+    return frame;
+}
+
+void Jr3Controller::doCaptureWork()
+{
+    printf("starting capture thread\n");
+
+    while (!sensorStopRequested)
+    {
+        const uint32_t frame = readFrame();
+
+        if (!captureQueue.push(frame))
+        {
+            captureOverruns++; // the sensor thread lags behind, it will discard the incomplete frame set
+            continue;
+        }
+
+        const uint16_t depth = captureQueue.size();
+
+        if (depth > captureHighWater)
+        {
+            captureHighWater = depth;
+        }
+
+        // wake up the sensor thread once per frame set instead of on every frame
+        if (frame == JR3_INVALID_FRAME || (frame & 0x000F0000) >> 16 == MOMENT_Z || depth >= captureQueue.capacity() / 2)
+        {
+            captureFlags.set(FRAMES_CAPTURED);
+        }
     }
+
+    printf("quitting capture thread\n");
 }
 
 void Jr3Controller::doSensorWork()
@@ -271,24 +913,147 @@ void Jr3Controller::doSensorWork()
     uint32_t frame;
     uint8_t address;
 
-    fixed_t raw[6], offset[6], decoupled[6], filtered[6], normalized[6];
-
+    fixed_t raw[6], offset[6], decoupled[6], filtered[6];
+    long long accumulators[6]; // decoupling in progress
+    int64_t decimationSums[6]; // boxcar over the current group of frame sets
+    uint16_t decimationCount = 0;
+    uint32_t groupTimestamp = 0; // start of the current group
+    uint32_t periodTimestamp = 0; // start of the current period measurement
+    uint16_t periodFrameSets = 0; // consecutive frame sets since then
+    wrench_sample sample;
+    sample_pair pair; // same as latest
+    bool published = false; // pair holds an actual sample
+
+    memset((void*)accumulators, 0, sizeof(accumulators));
+    memset((void*)decimationSums, 0, sizeof(decimationSums));
     memset((void*)raw, 0, sizeof(raw));
     memset((void*)offset, 0, sizeof(offset));
     memset((void*)decoupled, 0, sizeof(decoupled));
     memset((void*)filtered, 0, sizeof(filtered));
-    memset((void*)normalized, 0, sizeof(normalized));
+    memset((void*)&sample, 0, sizeof(sample));
+    memset((void*)&pair, 0, sizeof(pair));
 
-    mutex.lock();
-    fixed_t localSmoothingFactor = smoothingFactor;
-    bool localStopRequested = sensorStopRequested;
-    mutex.unlock();
+    uint16_t localDecimationFactor = decimationFactor;
+
+    // one filter per axis
+    BiquadFilter filters[6];
+    uint32_t filterSequence = filterCoeffs.sequence();
+    filter_bank localFilterCoeffs = filterCoeffs.load();
+
+    for (auto & filter : filters)
+    {
+        filter.reset(0);
+    }
+
+    // in lazy mode, raw channels are filtered and published as they are
+    const bool lazyDecoupling = decouplingMode == LAZY_DECOUPLING;
+    const fixed_t * unfiltered = lazyDecoupling ? raw : decoupled;
+    sample.raw = lazyDecoupling;
+
+    // async instants are served here rather than by the async thread, which would otherwise wake up on each of
+    // them; the latter only wakes up once a batch is complete
+    uint32_t gridSequence = asyncGrid.sequence();
+    async_grid grid = asyncGrid.load();
+    uint32_t nextInstant = grid.startUs;
+    uint16_t gridFilled = 0; // samples of the current batch
+    bool gridStale = false; // instants elapsed while the sensor was away are skipped
+
+    // takes the sample that acquire() would have returned at each instant elapsed by now
+    auto serveGrid = [&](uint32_t now)
+    {
+        if (static_cast<int32_t>(now - nextInstant) < 0)
+        {
+            return;
+        }
+
+        const uint32_t due = (now - nextInstant) / grid.periodUs + 1;
+
+        if (!published || gridStale)
+        {
+            nextInstant += due * grid.periodUs;
+            gridStale = false;
+            return;
+        }
+
+        // delayed by one (possibly decimated) sample period: the value at (instant - delay) lies between the two
+        // latest samples as long as the delay is not shorter than their spacing, therefore the age of the output
+        // is constant instead of jittering; right after start, both samples are the same one
+        const uint32_t delayUs = grid.interpolation ? measuredSamplingPeriod * 1e6f * localDecimationFactor + 0.5f : 0;
+        const int32_t span = pair.current.timestamp - pair.previous.timestamp;
+        wrench_sample instantSample = pair.current;
+
+        for (uint32_t i = 0; i < due; i++)
+        {
+            if (grid.interpolation)
+            {
+                const int32_t elapsed = (nextInstant + i * grid.periodUs - delayUs) - pair.previous.timestamp;
+                interpolateLinear(pair.previous.values, pair.current.values, span, elapsed, instantSample.values, 6);
+            }
+
+            if (!asyncQueue.push(instantSample))
+            {
+                missedDeadlines++; // the async thread lags behind by more than a batch
+            }
+            else if (++gridFilled == grid.batchSize)
+            {
+                gridFilled = 0;
+                asyncFlags.set(BATCH_READY);
+            }
+        }
+
+        nextInstant += due * grid.periodUs;
+    };
 
     jr3_channel expectedChannel = FORCE_X;
+    bool resyncing = false; // a gap was found, waiting for the next frame set
+
+    PipelineProfiler<PIPELINE_STAGES> profiler; // no-op unless JR3_PROFILING is enabled
 
-    while (!localStopRequested)
+    while (!sensorStopRequested)
     {
-        frame = readerCallback();
+        profiler.mark();
+        frame = nextFrame();
+        profiler.lap(STAGE_READ_FRAME);
+
+        if (frame == JR3_INVALID_FRAME)
+        {
+            if (sensorStopRequested)
+            {
+                break; // nothing was read, see nextFrame()
+            }
+
+            // only returned by timeout-aware readers, e.g. Jr3Reader::tryReadFrame(); the stop request
+            // is checked again right away, hence stopping this thread takes a bounded time
+            if (expectedChannel != FORCE_X)
+            {
+                discardedFrameSets++;
+            }
+
+            profiler.discard(STAGE_DECOUPLING);
+            readTimeouts++;
+            resyncing = false;
+            sensorStale = true; // published samples are now outdated
+            gridStale = true; // do not hand them out to the async thread either
+            periodFrameSets = 0;
+            expectedChannel = FORCE_X;
+            continue;
+        }
+
+        if (sensorStale)
+        {
+            // the clock line is back
+            if (recoverSensor())
+            {
+                recoveries++;
+                sensorStale = false;
+            }
+
+            periodFrameSets = 0;
+            expectedChannel = FORCE_X;
+            resyncing = false;
+            continue;
+        }
+
         address = (frame & 0x000F0000) >> 16;
 
 #if DBG
@@ -307,45 +1072,204 @@ void Jr3Controller::doSensorWork()
 
         if (address != expectedChannel) // in case any channel is skipped
         {
+            if (expectedChannel != FORCE_X || (address > FORCE_X && address <= MOMENT_Z))
+            {
+                // either a frame set was in progress or FORCE_X itself was missed, whatever was collected so far
+                // is lost; the remaining axis frames of this set land here as well, count the gap only once
+                if (!resyncing)
+                {
+                    profiler.discard(STAGE_DECOUPLING);
+                    discardedFrameSets++;
+                    skippedChannels++;
+                    periodFrameSets = 0; // the measurement window must not contain gaps
+                    resyncing = true;
+                }
+            }
+            else
+            {
+                resyncing = false; // voltage and calibration frames are expected between frame sets
+            }
+
             expectedChannel = FORCE_X;
             continue;
         }
 
-        raw[address - 1] = jr3ToFixedPoint(frame & 0x0000FFFF);
+        resyncing = false;
+
+        if (lazyDecoupling)
+        {
+            raw[address - 1] = jr3ToFixedPoint(frame & 0x0000FFFF);
+        }
+        else
+        {
+            if (address == FORCE_X)
+            {
+                memset((void*)accumulators, 0, sizeof(accumulators));
+            }
+
+            // decouple incrementally: accumulate the contribution of this axis (a column of the calibration
+            // matrix) right away, i.e. during the idle time until the next frame arrives, instead of performing
+            // all multiplications in a burst after the last axis
+            fixedpoint::accumulate_matrix_column<6, 6>(calibrationCoeffs, address - 1, jr3ToFixedPoint(frame & 0x0000FFFF), accumulators);
+        }
 
         if (address != MOMENT_Z)
         {
+            profiler.split(STAGE_DECOUPLING); // recorded along with the last axis
             expectedChannel = static_cast<jr3_channel>(expectedChannel + 1);
             continue; // keep reading frames until we get all six axis values
         }
 
+        const uint32_t timestamp = us_ticker_read(); // arrival of the last axis
+
+        if (!lazyDecoupling)
+        {
+            fixedpoint::accumulators_to_fixed<6>(accumulators, decoupled);
+        }
+
+        profiler.lap(STAGE_DECOUPLING);
+
         for (int i = 0; i < 6; i++)
         {
-            decoupled[i] = fixedpoint::multiply_accumulate(6, calibrationCoeffs + (i * 6), raw);
+            filtered[i].intValue = filters[i].process(localFilterCoeffs.axes[i], unfiltered[i].intValue);
+
+            sample.values[i] = filtered[i] - offset[i];
+        }
 
-            // first-order low-pass IIR filter (as an exponential moving average)
-            filtered[i] += localSmoothingFactor * (decoupled[i] - filtered[i]);
+        if (zeroOffsets && zeroOffsets.exchange(false))
+        {
+            memcpy(offset, filtered, sizeof(filtered));
+            memset((void*)sample.values, 0, sizeof(sample.values));
+            memset((void*)decimationSums, 0, sizeof(decimationSums));
+            decimationCount = 0; // start a new group
+        }
 
-            normalized[i] = filtered[i] - offset[i];
+        if (decimationCount == 0)
+        {
+            groupTimestamp = timestamp;
         }
 
-        mutex.lock();
+        profiler.lap(STAGE_FILTERING);
 
-        if (zeroOffsets)
+        // checked right before serving, the async thread discards queued samples on each change
+        if (asyncGrid.sequence() != gridSequence)
         {
-            memcpy(offset, filtered, sizeof(filtered));
-            memset((void*)shared, 0, sizeof(shared));
-            zeroOffsets = false;
+            gridSequence = asyncGrid.sequence();
+            grid = asyncGrid.load();
+            nextInstant = grid.startUs;
+            gridFilled = 0;
         }
-        else
+
+        if (grid.periodUs != 0)
         {
-            memcpy(shared, normalized, sizeof(normalized));
+            serveGrid(timestamp); // with the samples published so far
         }
 
-        localSmoothingFactor = smoothingFactor;
-        localStopRequested = sensorStopRequested;
-        frameCounter++;
-        mutex.unlock();
+        if (localDecimationFactor > 1)
+        {
+            // the mean of N samples is kept at full precision, hence the extra resolution of acquireExtended()
+            for (int i = 0; i < 6; i++)
+            {
+                decimationSums[i] += sample.values[i].intValue;
+            }
+        }
+
+        if (++decimationCount >= localDecimationFactor)
+        {
+            if (localDecimationFactor > 1)
+            {
+                for (int i = 0; i < 6; i++)
+                {
+                    sample.values[i].intValue = divideRounded(decimationSums[i], localDecimationFactor);
+                }
+
+                memset((void*)decimationSums, 0, sizeof(decimationSums));
+            }
+
+            decimationCount = 0;
+
+            sample.frameCounter++;
+            sample.timestamp = groupTimestamp + (timestamp - groupTimestamp) / 2; // middle of the group
+            pair = {published ? pair.current : sample, sample}; // nothing to interpolate from at first
+            latest.store(pair);
+            published = true;
+
+            if (historyAttached) // no consumer yet otherwise, see acquireBatch()
+            {
+                if (!history.push(sample))
+                {
+                    historyOverruns++; // the newest sample is lost if the consumer lags behind
+                }
+                else if (history.size() > historyHighWater)
+                {
+                    historyHighWater = history.size();
+                }
+            }
+        }
+
+        completedFrameSets++;
+
+        profiler.lap(STAGE_PUBLICATION);
+
+        if (periodFrameSets == 0)
+        {
+            periodTimestamp = timestamp;
+        }
+        else if (periodFrameSets == PERIOD_WINDOW)
+        {
+            const float period = (timestamp - periodTimestamp) * 1e-6f / PERIOD_WINDOW;
+            const float current = filterPeriod;
+            measuredSamplingPeriod = period;
+
+            // computing coefficients takes far longer than a frame set, leave it to the filter thread;
+            // new coefficients are picked up below
+            if (fabsf(period - current) > PERIOD_TOLERANCE * current)
+            {
+                filterFlags.set(PERIOD_CHANGED);
+            }
+
+            periodTimestamp = timestamp;
+            periodFrameSets = 0;
+        }
+
+        periodFrameSets++;
+
+#if JR3_PROFILING
+        if ((completedFrameSets & 0x3F) == 0)
+        {
+            pipelineStats.store(profiler.getStats()); // not on every frame set, this is quite a big struct
+        }
+#endif
+
+        if (filterCoeffs.sequence() != filterSequence)
+        {
+            filterSequence = filterCoeffs.sequence();
+            const filter_bank bank = filterCoeffs.load();
+
+            for (int i = 0; i < 6; i++)
+            {
+                if (memcmp(&bank.axes[i], &localFilterCoeffs.axes[i], sizeof(BiquadFilter::coefficients)) != 0)
+                {
+                    filters[i].reset(filtered[i].intValue); // resume smoothly from the current output
+                }
+            }
+
+            localFilterCoeffs = bank;
+        }
+
+        if (timingReset && timingReset.exchange(false))
+        {
+            // cycle counts are not comparable anymore, and the measurement window spans both clock rates
+            profiler.reset();
+            periodFrameSets = 0;
+        }
+
+        if (decimationFactor != localDecimationFactor)
+        {
+            localDecimationFactor = decimationFactor;
+            memset((void*)decimationSums, 0, sizeof(decimationSums));
+            decimationCount = 0; // discard the incomplete group
+        }
 
         expectedChannel = FORCE_X;
     }
@@ -357,23 +1281,76 @@ void Jr3Controller::doAsyncWork()
 {
     printf("starting async thread\n");
 
-    uint16_t data[7]; // fx, fy, fz, mx, my, mz, frame counter
+    // consecutive samples of fx, fy, fz, mx, my, mz, frame counter
+    uint16_t data[7 * decltype(asyncQueue)::capacity()];
+    overrun_policy localPolicy;
+    uint16_t localBatchSize;
+    wrench_sample sample;
 
-    mutex.lock();
-    bool localStopRequested = asyncStopRequested;
-    std::chrono::microseconds localAsyncPeriodUs = asyncPeriodUs;
-    mutex.unlock();
-
-    while (!localStopRequested)
+    // samples are taken by the sensor thread on the period grid (see doSensorWork()), this thread only wakes
+    // up once per batch, hence neither the callback nor the wake-up latency accumulate over time
+    auto configure = [&]()
     {
-        acquireInternal(data);
-        asyncCallback(data);
-        waiter.wait_for(localAsyncPeriodUs);
-
         mutex.lock();
-        localStopRequested = asyncStopRequested;
-        localAsyncPeriodUs = asyncPeriodUs;
+        const async_grid grid {us_ticker_read(), static_cast<uint32_t>(asyncPeriodUs.count()), asyncBatchSize, asyncInterpolation};
+        localPolicy = asyncOverrunPolicy;
+        localBatchSize = asyncBatchSize;
         mutex.unlock();
+
+        asyncGrid.store(grid); // start over with the new settings
+        while (asyncQueue.pop(sample)) {} // discard the incomplete batch, if any
+    };
+
+    configure();
+
+    while (true)
+    {
+        const uint32_t flags = asyncFlags.wait_any(BATCH_READY | ASYNC_SETTINGS_CHANGED | ASYNC_THREAD_STOP);
+
+        if ((flags & osFlagsError) != 0 || (flags & ASYNC_THREAD_STOP) != 0)
+        {
+            break;
+        }
+
+        if (flags & ASYNC_SETTINGS_CHANGED)
+        {
+            configure();
+            continue;
+        }
+
+        // more than one complete batch if the previous callbacks took too long
+        std::size_t pending = asyncQueue.size() / localBatchSize * localBatchSize;
+
+        if (pending == 0)
+        {
+            continue;
+        }
+
+        missedDeadlines += pending / localBatchSize - 1;
+
+        if (localPolicy == SKIP_MISSED)
+        {
+            for (; pending > localBatchSize; pending--)
+            {
+                asyncQueue.pop(sample);
+            }
+        }
+
+        const std::size_t perCallback = localPolicy == COALESCE ? pending : localBatchSize;
+
+        while (pending > 0)
+        {
+            uint16_t filled = 0;
+
+            while (filled < perCallback && asyncQueue.pop(sample))
+            {
+                decodeSample(sample, data + (7 * filled));
+                filled++;
+            }
+
+            asyncCallback(data, filled);
+            pending -= perCallback;
+        }
     }
 
     printf("quitting async thread\n");
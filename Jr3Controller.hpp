@@ -2,26 +2,109 @@
 #define __JR3_CONTROLLER_HPP__
 
 #include "mbed.h"
+#include "atomic"
 #include "chrono"
-#include "AccurateWaiter/AccurateWaiter.h"
+#include "BiquadFilter.hpp"
+#include "CalibrationStorage.hpp"
+#include "Profiler.hpp"
+#include "RingBuffer.hpp"
+#include "SeqLock.hpp"
 #include "utils.hpp"
 
 class Jr3Controller
 {
 public:
+    // INITIALIZING and FAILED only occur with background initialization, see startInitialization()
     enum jr3_state
-    { UNINITIALIZED, READY };
+    { UNINITIALIZED, READY, INITIALIZING, FAILED };
 
-    Jr3Controller(mbed::Callback<uint32_t()> cb);
-    void initialize();
+    // samples are always taken on the original period grid, this is what the async thread does when it finds
+    // more than one complete batch waiting, e.g. because a callback took longer than the batch period:
+    // - SKIP_MISSED: drop the older batches and deliver the newest one
+    // - CATCH_UP: run one callback per batch back-to-back
+    // - COALESCE: run a single callback for all of them
+    enum overrun_policy
+    { SKIP_MISSED, CATCH_UP, COALESCE };
+
+    // sensor thread stages timed when JR3_PROFILING is enabled, see Profiler.hpp; STAGE_READ_FRAME is recorded
+    // once per frame, the remaining stages once per completed frame set
+    enum pipeline_stage
+    { STAGE_READ_FRAME, STAGE_DECOUPLING, STAGE_FILTERING, STAGE_PUBLICATION, PIPELINE_STAGES };
+
+    using profiling_stats = pipeline_stats<PIPELINE_STAGES>;
+
+    // where the calibration matrix is applied:
+    // - EAGER_DECOUPLING: by the sensor thread on every frame set, samples are published decoupled
+    // - LAZY_DECOUPLING: filtering and offset removal act on raw channels (all these operations are linear),
+    //   the matrix is applied by the consumer on each acquire() call, i.e. at consumer rate
+    enum decoupling_mode
+    { EAGER_DECOUPLING, LAZY_DECOUPLING };
+
+    // low-pass filter, optionally followed by a notch filter; each axis can be configured independently,
+    // note that filters act on raw channels instead in LAZY_DECOUPLING mode
+    enum filter_type
+    { FIRST_ORDER, BUTTERWORTH_2, BUTTERWORTH_4 };
+
+    // counted since the sensor thread was last started
+    struct acquisition_stats
+    {
+        uint32_t completedFrameSets;
+        uint32_t discardedFrameSets; // partial frame sets thrown away because of a skipped channel or a timeout
+        uint32_t skippedChannels; // gaps in the channel sequence, one or more consecutive frames each
+        uint32_t falseStartPulses; // as reported by the reader, if available, updated every 256 frames
+        uint32_t historyOverruns; // samples not stored in the history because of a lagging consumer, see acquireBatch()
+        uint32_t readTimeouts; // the reader gave up waiting for a frame, see JR3_INVALID_FRAME
+        uint32_t recoveries; // the sensor came back after a timeout
+        uint32_t captureOverruns; // frames dropped because the capture queue was full (pipelined mode only)
+        uint16_t captureQueueDepth; // frames waiting to be processed (pipelined mode only)
+        uint16_t captureQueueHighWater;
+        uint16_t historyDepth; // samples waiting to be drained by acquireBatch()
+        uint16_t historyHighWater;
+    };
+
+    // durations of the last initialization, in [us]
+    struct initialization_stats
+    {
+        uint32_t verificationUs; // comparison against the cached calibration, if any
+        uint32_t collectionUs; // full EEPROM scan, zero if the cached calibration was used
+        uint32_t storageUs; // cache load and update
+        uint32_t totalUs;
+        uint16_t calibrationFrames; // received during the full scan, including duplicates
+        bool cacheHit;
+    };
+
+    // the optional second callback should return the accumulated number of false start pulses
+    // detected by the reader, e.g. Jr3Reader::getFalseStartPulses()
+    Jr3Controller(mbed::Callback<uint32_t()> cb, mbed::Callback<uint32_t()> falseStartPulsesCb = nullptr);
+    void initialize(); // blocks until done, but not longer than the default timeout
+    void startInitialization(std::chrono::milliseconds timeout = DEFAULT_INITIALIZATION_TIMEOUT);
+    uint8_t getInitializationProgress() const; // [%]
+    void setCalibrationStorage(CalibrationStorage * storage); // not owned, nullptr disables caching
     void startSync(uint16_t cutOffFrequency);
-    void startAsync(mbed::Callback<void(uint16_t *)> cb, uint16_t cutOffFrequency, uint32_t periodUs);
+    // the callback receives the batch and the number of samples in it (7 elements each)
+    void startAsync(mbed::Callback<void(uint16_t *, uint16_t)> cb, uint16_t cutOffFrequency, uint32_t periodUs,
+                    overrun_policy policy = SKIP_MISSED, uint16_t batchSize = 1);
     void stop();
     void calibrate();
-    void setFilter(uint16_t cutOffFrequency);
+    void setFilter(uint16_t cutOffFrequency); // all axes, keeps their current filter type and notch
+    void setFilter(uint16_t cutOffFrequency, filter_type type, uint16_t notchFrequency = 0); // all axes
+    void setAxisFilter(uint8_t axis, uint16_t cutOffFrequency, filter_type type, uint16_t notchFrequency = 0);
+    void setDecouplingMode(decoupling_mode mode); // applied on next start
+    void setPipelining(bool enable); // separate capture and processing threads, applied on next start, see README
+    void setDecimation(uint16_t factor); // publish the mean of each group of factor frame sets, 1: disabled
+    void setInterpolation(bool enable); // resample on the async period grid, see README
+    void onSystemFrequencyChange(uint32_t hz); // see addSystemFrequencyListener() in overclocking.hpp
     void getFullScales(uint16_t * data) const;
     bool acquire(uint16_t * data) const;
+    bool acquireExtended(int32_t * data) const; // same as acquire(), but with 15 more bits of resolution
+    std::size_t acquireBatch(uint16_t * buffer, std::size_t maxSamples);
     jr3_state getState() const;
+    bool isStale() const; // the sensor stopped sending frames, acquire() fails in the meantime
+    uint32_t getMissedDeadlines() const;
+    float getSamplingPeriod() const; // measured frame set period [s]
+    bool getPipelineStats(profiling_stats & stats) const;
+    acquisition_stats getAcquisitionStats() const;
+    initialization_stats getInitializationStats() const;
 
 private:
     enum jr3_channel : uint8_t
@@ -32,35 +115,182 @@ private:
         CALIBRATION
     };
 
+    struct filter_settings
+    {
+        uint16_t cutOffFrequency; // [0.01*Hz]
+        filter_type type;
+        uint16_t notchFrequency; // [0.01*Hz]
+    };
+
+    // coefficients of all axes, contiguous so that the sensor thread walks a single array
+    struct filter_bank
+    {
+        BiquadFilter::coefficients axes[6];
+    };
+
+    struct calibration_matrix
+    {
+        fixed_t values[36];
+    };
+
+    struct wrench_sample
+    {
+        fixed_t values[6];
+        uint16_t frameCounter;
+        bool raw; // not decoupled yet, see LAZY_DECOUPLING
+        uint32_t timestamp; // [us] us ticker, wraps around
+    };
+
+    // the two most recent samples, so that consumers can interpolate between them
+    struct sample_pair
+    {
+        wrench_sample previous;
+        wrench_sample current;
+    };
+
+    // async sampling instants, published by the async thread and served by the sensor thread
+    struct async_grid
+    {
+        uint32_t startUs; // [us] us ticker, first instant
+        uint32_t periodUs; // zero if disabled
+        uint16_t batchSize;
+        bool interpolation;
+    };
+
+    // shared by the initialization supervisor and its worker, lives on the stack of the former
+    struct initialization_context
+    {
+        calibration_record record;
+        bool cached; // the record was loaded from the cache and is valid
+        initialization_stats stats;
+    };
+
+    void doInitialization();
+    void doInitializationWork();
+    bool verifyCalibration(const uint8_t * eeprom);
+    uint16_t collectCalibration(uint8_t * eeprom, bool interruptible = false);
+    bool recoverSensor();
+    void printCalibration(const uint8_t * eeprom) const;
     void startSensorThread();
     void startAsyncThread();
     void stopSensorThread();
     void stopAsyncThread();
     void acquireInternal(uint16_t * data) const;
+    void decodeSample(const wrench_sample & sample, uint16_t * data) const;
+    void decoupleSample(const wrench_sample & sample, fixed_t * values) const;
+    uint32_t readFrame();
+    uint32_t nextFrame();
+    void doCaptureWork();
     void doSensorWork();
+    void updateFilters();
+    void doFilterWork();
     void doAsyncWork();
 
     rtos::Thread * sensorThread {nullptr};
+    rtos::Thread * captureThread {nullptr}; // pipelined mode only, feeds the sensor thread
+    rtos::Thread * filterThread {nullptr}; // recomputes filters when the measured period changes
     rtos::Thread * asyncThread {nullptr};
+    rtos::Thread * initializationThread {nullptr};
+    rtos::EventFlags initializationFlags;
+    rtos::EventFlags captureFlags;
+    rtos::EventFlags filterFlags;
+    rtos::EventFlags asyncFlags;
     mutable rtos::Mutex mutex;
     mbed::Callback<uint32_t()> readerCallback;
-    mbed::Callback<void(uint16_t *)> asyncCallback;
-    AccurateWaiter waiter;
-    jr3_state state {UNINITIALIZED};
+    mbed::Callback<uint32_t()> falseStartPulsesCallback;
+    mbed::Callback<void(uint16_t *, uint16_t)> asyncCallback;
+    CalibrationStorage * calibrationStorage {nullptr};
+    initialization_stats initializationStats {};
+    initialization_context * initializationContext {nullptr};
+    std::chrono::milliseconds initializationTimeout {0ms};
+    std::atomic<uint16_t> initializationProgress {0}; // EEPROM bytes processed so far
+    std::atomic<jr3_state> state {UNINITIALIZED};
 
     fixed_t calibrationCoeffs[36] {}; // value initialization to zero
-    fixed_t shared[6] {}; // value initialization to zero
-    uint16_t fullScales[6] {}; // value initialization to zero
-    uint16_t frameCounter {0};
+    uint16_t fullScales[6] {}; // value initialization to zero, guarded by the mutex while the sensor thread runs
+
+    // copy of the calibration matrix for consumers that decouple samples (LAZY_DECOUPLING), since the
+    // sensor thread might update it after a recovery
+    SeqLock<calibration_matrix> sharedCalibration;
     std::chrono::microseconds asyncPeriodUs {0us};
+    overrun_policy asyncOverrunPolicy {SKIP_MISSED};
+    uint16_t asyncBatchSize {1};
+    bool asyncInterpolation {false};
+    decoupling_mode decouplingMode {EAGER_DECOUPLING}; // read by the sensor thread on start
+    bool pipelining {false};
+    std::atomic<uint32_t> missedDeadlines {0};
+
+    // latest processed samples, written by the sensor thread only
+    SeqLock<sample_pair> latest;
+
+    // samples taken on the async grid, from the sensor thread to the async thread; room for two batches
+    // of MAX_ASYNC_BATCH samples, so that a slow callback does not lose the batch that follows
+    SeqLock<async_grid> asyncGrid;
+    RingBuffer<wrench_sample, 32> asyncQueue;
+
+    // every processed sample, drained by acquireBatch(); only recorded once a consumer has shown up
+    RingBuffer<wrench_sample, 128> history;
+    std::atomic<bool> historyAttached {false};
+
+    // raw frames, from the capture thread to the sensor thread (pipelined mode), about 1 ms worth of data
+    RingBuffer<uint32_t, 64> captureQueue;
+
+#if JR3_PROFILING
+    SeqLock<profiling_stats> pipelineStats;
+#endif
+
+    // written by the sensor thread only
+    std::atomic<uint32_t> completedFrameSets {0};
+    std::atomic<uint32_t> discardedFrameSets {0};
+    std::atomic<uint32_t> skippedChannels {0};
+    std::atomic<uint32_t> historyOverruns {0};
+    std::atomic<uint32_t> readTimeouts {0};
+    std::atomic<uint32_t> recoveries {0};
+    std::atomic<uint16_t> historyHighWater {0};
+    std::atomic<bool> sensorStale {false};
+
+    // written by the thread that calls the reader, i.e. the capture thread in pipelined mode
+    std::atomic<uint32_t> falseStartPulses {0};
+    uint32_t falseStartPulsesBaseline {0};
+    uint32_t readerFrames {0};
+
+    // written by the capture thread only
+    std::atomic<uint32_t> captureOverruns {0};
+    std::atomic<uint16_t> captureHighWater {0};
+
+    // accessed by the sensor thread on each iteration, hence lock-free
+    std::atomic<bool> sensorStopRequested {false};
+    std::atomic<bool> zeroOffsets {false};
+    std::atomic<bool> timingReset {false};
+    std::atomic<uint16_t> decimationFactor {1};
 
-    bool sensorStopRequested {false};
-    bool asyncStopRequested {false};
-    bool zeroOffsets {false};
+    // written by setFilter(), polled by the sensor thread once per frame set (default: unfiltered)
+    SeqLock<filter_bank> filterCoeffs;
+    filter_settings filterSettings[6] {}; // guarded by the mutex
+    std::atomic<float> filterPeriod {samplingPeriod}; // used to compute the current coefficients, written with the mutex held
 
-    fixed_t smoothingFactor {1.0f}; // default: unfiltered
+    // measured by the sensor thread, filters are recomputed if it deviates from the nominal period
+    std::atomic<float> measuredSamplingPeriod {samplingPeriod};
 
-    static constexpr float samplingPeriod = 128.5e-6f; // [s]
+    static constexpr float samplingPeriod = 128.5e-6f; // [s] nominal, until a measurement is available
+    static constexpr std::chrono::milliseconds DEFAULT_INITIALIZATION_TIMEOUT {1000ms};
+    static constexpr uint32_t INITIALIZATION_STACK_SIZE = 2560; // [bytes] initialization_context, storage and printf
+    static constexpr uint32_t INITIALIZATION_WORKER_STACK_SIZE = 1024; // [bytes] only reads frames and parses the EEPROM
+    static constexpr uint32_t INITIALIZATION_DONE = 0x01;
+    static constexpr uint32_t FRAMES_CAPTURED = 0x01;
+    static constexpr uint32_t PERIOD_CHANGED = 0x01;
+    static constexpr uint32_t FILTER_THREAD_STOP = 0x02;
+    static constexpr uint32_t BATCH_READY = 0x01;
+    static constexpr uint32_t ASYNC_SETTINGS_CHANGED = 0x02;
+    static constexpr uint32_t ASYNC_THREAD_STOP = 0x04;
+    // EEPROM bytes parsed by jr3ParseCalibration(), all of them are compared against the cache on startup
+    static constexpr int CALIBRATION_REGION_START = 10;
+    static constexpr int CALIBRATION_REGION_END = 130; // exclusive
+    static constexpr uint16_t PERIOD_WINDOW = 1024; // frame sets per period measurement
+    static constexpr float PERIOD_TOLERANCE = 0.01f; // relative change that triggers a filter update
+    static constexpr uint32_t FILTER_THREAD_STACK_SIZE = 1536; // [bytes] two copies of filter_bank plus soft-float math
+    static constexpr uint16_t MAX_ASYNC_BATCH = 16; // samples per async callback
+    static constexpr double NOTCH_QUALITY = 5.0; // bandwidth = frequency / quality
 };
 
 #endif // __JR3_CONTROLLER_HPP__
@@ -0,0 +1,98 @@
+#ifndef __JR3_FRAME_ALIGNER_HPP__
+#define __JR3_FRAME_ALIGNER_HPP__
+
+#include "cstdint"
+
+// platform-independent frame synchronizer for a JR3 bitstream captured by a serial peripheral;
+// start pulses do not toggle the clock signal, hence a peripheral shifting bits on clock edges only
+// receives the 20 data bits of each frame glued together with no delimiter in between, frame boundaries
+// are therefore recovered from the channel addresses, which cycle through 0..7 in the upper nibble
+
+class Jr3FrameAligner
+{
+public:
+    // feeds the next received word (MSB first), returns true and stores a frame if one was completed
+    bool push(uint16_t word, uint32_t & frame);
+    void reset();
+
+    bool isLocked() const
+    { return locked; }
+
+    // number of times the lock was lost after having been acquired
+    uint32_t getResynchronizations() const
+    { return resynchronizations; }
+
+    static constexpr unsigned int WORD_SIZE = 16;
+    static constexpr unsigned int FRAME_SIZE = 20;
+    static constexpr unsigned int LOCK_FRAMES = 8; // consecutive well-formed frames, i.e. a whole channel cycle
+
+private:
+    static uint8_t addressOf(uint32_t frame)
+    { return (frame >> 16) & 0x0F; }
+
+    uint32_t peek() const
+    { return static_cast<uint32_t>(bits >> (available - FRAME_SIZE)) & ((1UL << FRAME_SIZE) - 1); }
+
+    uint64_t bits {0}; // only the lower 'available' bits are meaningful
+    unsigned int available {0};
+    bool locked {false};
+    unsigned int matches {0};
+    uint8_t expectedAddress {0};
+    uint32_t resynchronizations {0};
+};
+
+inline bool Jr3FrameAligner::push(uint16_t word, uint32_t & frame)
+{
+    bits = (bits << WORD_SIZE) | word;
+    available += WORD_SIZE;
+
+    // at most 19 + 16 bits are buffered at this point, so no more than one frame can be completed per word
+    while (available >= FRAME_SIZE)
+    {
+        const uint32_t candidate = peek();
+        const uint8_t address = addressOf(candidate);
+
+        if (locked)
+        {
+            available -= FRAME_SIZE;
+
+            if (address == expectedAddress)
+            {
+                expectedAddress = (address + 1) & 0x07;
+                frame = candidate;
+                return true;
+            }
+
+            // a bit was lost or inserted, discard this frame and start hunting again
+            locked = false;
+            matches = 0;
+            resynchronizations++;
+            continue;
+        }
+
+        if (address < 8 && (matches == 0 || address == expectedAddress))
+        {
+            available -= FRAME_SIZE;
+            expectedAddress = (address + 1) & 0x07;
+            locked = ++matches >= LOCK_FRAMES;
+        }
+        else
+        {
+            available -= 1; // slip by one bit and try again
+            matches = 0;
+        }
+    }
+
+    return false;
+}
+
+inline void Jr3FrameAligner::reset()
+{
+    bits = 0;
+    available = 0;
+    locked = false;
+    matches = 0;
+    expectedAddress = 0;
+}
+
+#endif // __JR3_FRAME_ALIGNER_HPP__
@@ -0,0 +1,134 @@
+#ifndef __JR3_FRAME_DECODER_HPP__
+#define __JR3_FRAME_DECODER_HPP__
+
+#include "cstdint"
+
+// platform-independent state machine that assembles JR3 frames out of a sequence of edge events,
+// it follows the same rules as Jr3::awaitNextFrame() and Jr3::readFrame() and does not depend on Mbed
+
+class Jr3FrameDecoder
+{
+public:
+    enum edge_event : uint8_t
+    { CLOCK_RISING, DATA_FALLING, DATA_RISING };
+
+    enum pin_state : uint8_t
+    {
+        DATA_LOW_CLOCK_LOW = 0,
+        DATA_LOW_CLOCK_HIGH = 1U << 0,
+        DATA_HIGH_CLOCK_LOW = 1U << 1,
+        DATA_HIGH_CLOCK_HIGH = DATA_LOW_CLOCK_HIGH | DATA_HIGH_CLOCK_LOW
+    };
+
+    // 'level' is the data line level on clock edges, and the clock line level on data edges;
+    // returns true and stores the assembled frame once its last bit has been sampled
+    bool push(edge_event edge, bool level, uint32_t & frame);
+
+    // convenience overload for sampled waveforms, edges are inferred from the previous pin state
+    bool push(pin_state pins, uint32_t & frame);
+
+    void reset();
+
+    // clock edges are only relevant while a start pulse or a frame is in progress
+    bool wantsClockEdges() const
+    { return state != AWAIT_START_PULSE; }
+
+    // data edges are only relevant while there is no frame in progress
+    bool wantsDataEdges() const
+    { return state != READING_BITS; }
+
+    uint32_t getFalseStartPulses() const
+    { return falseStartPulses; }
+
+private:
+    enum decoder_state : uint8_t
+    { AWAIT_START_PULSE, START_PULSE, READING_BITS };
+
+    decoder_state state {AWAIT_START_PULSE};
+    pin_state previous {DATA_HIGH_CLOCK_HIGH};
+    uint32_t bits {0};
+    uint32_t remaining {0};
+    uint32_t falseStartPulses {0};
+
+    static constexpr unsigned int FRAME_SIZE = 20;
+};
+
+inline bool Jr3FrameDecoder::push(edge_event edge, bool level, uint32_t & frame)
+{
+    switch (state)
+    {
+    case AWAIT_START_PULSE:
+        // the start pulse begins with a falling edge on the data signal while the clock is kept high
+        if (edge == DATA_FALLING && level)
+        {
+            state = START_PULSE;
+        }
+
+        break;
+
+    case START_PULSE:
+        if (edge == DATA_RISING && level)
+        {
+            // start pulse completed, we can start processing a new frame
+            state = READING_BITS;
+            bits = 0;
+            remaining = FRAME_SIZE;
+        }
+        else
+        {
+            state = AWAIT_START_PULSE; // this is not a start pulse, retry
+            falseStartPulses++;
+        }
+
+        break;
+
+    case READING_BITS:
+        if (edge == CLOCK_RISING)
+        {
+            bits = (bits << 1) | (level ? 1U : 0U);
+
+            if (--remaining == 0)
+            {
+                state = AWAIT_START_PULSE;
+                frame = bits;
+                return true;
+            }
+        }
+
+        break;
+    }
+
+    return false;
+}
+
+inline bool Jr3FrameDecoder::push(pin_state pins, uint32_t & frame)
+{
+    const pin_state changed = static_cast<pin_state>(pins ^ previous);
+    const bool clock = pins & DATA_LOW_CLOCK_HIGH;
+    const bool data = pins & DATA_HIGH_CLOCK_LOW;
+    bool done = false;
+
+    previous = pins;
+
+    if ((changed & DATA_LOW_CLOCK_HIGH) && clock)
+    {
+        done = push(CLOCK_RISING, data, frame);
+    }
+
+    if (changed & DATA_HIGH_CLOCK_LOW)
+    {
+        done |= push(data ? DATA_RISING : DATA_FALLING, clock, frame);
+    }
+
+    return done;
+}
+
+inline void Jr3FrameDecoder::reset()
+{
+    state = AWAIT_START_PULSE;
+    previous = DATA_HIGH_CLOCK_HIGH;
+    bits = 0;
+    remaining = 0;
+}
+
+#endif // __JR3_FRAME_DECODER_HPP__
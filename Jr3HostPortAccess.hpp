@@ -0,0 +1,77 @@
+#ifndef __JR3_HOST_PORT_ACCESS_HPP__
+#define __JR3_HOST_PORT_ACCESS_HPP__
+
+#include "chrono"
+#include "cstddef"
+#include "cstdint"
+
+// port access policy for Jr3Reader that replays a sampled waveform from memory instead of reading
+// a GPIO port, meant for host builds; each call to read() yields the next sample, the waveform is
+// played back in a loop, hence readFrame() never runs out of data; alternatively, the last sample
+// is held forever once the waveform has been played, which mimics a sensor that stops sending
+
+template <unsigned int clockBit = 0, unsigned int dataBit = 1>
+class HostPortAccess
+{
+    static_assert(clockBit < 32 && dataBit < 32 && clockBit != dataBit, "invalid bit positions");
+
+public:
+    static constexpr uint32_t CLOCK_MASK = 1UL << clockBit;
+    static constexpr uint32_t DATA_MASK = 1UL << dataBit;
+
+    // the waveform is not copied, it must outlive this object
+    HostPortAccess(const uint32_t * samples, std::size_t count, bool loop = true)
+        : samples(samples), count(count), loop(loop)
+    {}
+
+    uint32_t read() const
+    {
+        const uint32_t sample = samples[index];
+        index = index + 1 < count ? index + 1 : (loop ? 0 : index);
+        reads++;
+        return sample;
+    }
+
+    uint32_t nowUs() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // total number of port reads, useful to measure decoding throughput
+    uint64_t getReads() const
+    { return reads; }
+
+    // writes the minimal waveform of a single frame (one sample per signal level) into the output buffer,
+    // which must be able to hold at least SAMPLES_PER_FRAME elements; returns the number of samples
+    static std::size_t encodeFrame(uint32_t frame, uint32_t * out)
+    {
+        std::size_t n = 0;
+
+        // interval between frames, then start pulse: falling and rising edge on data while clock is high
+        out[n++] = CLOCK_MASK | DATA_MASK;
+        out[n++] = CLOCK_MASK;
+        out[n++] = CLOCK_MASK | DATA_MASK;
+
+        for (int i = FRAME_SIZE - 1; i >= 0; i--)
+        {
+            // data is sampled on the rising edge of the clock signal
+            const uint32_t data = (frame & (1UL << i)) ? DATA_MASK : 0;
+            out[n++] = data;
+            out[n++] = data | CLOCK_MASK;
+        }
+
+        return n;
+    }
+
+    static constexpr unsigned int FRAME_SIZE = 20;
+    static constexpr std::size_t SAMPLES_PER_FRAME = 3 + 2 * FRAME_SIZE;
+
+private:
+    const uint32_t * samples;
+    std::size_t count;
+    bool loop;
+    mutable std::size_t index {0};
+    mutable uint64_t reads {0};
+};
+
+#endif // __JR3_HOST_PORT_ACCESS_HPP__
@@ -0,0 +1,234 @@
+#ifndef __JR3_INTERRUPT_HPP__
+#define __JR3_INTERRUPT_HPP__
+
+#include "mbed.h"
+#include "LPC17xx.h"
+#include "Jr3PortAccess.hpp"
+#include "Jr3FrameDecoder.hpp"
+#include "RingBuffer.hpp"
+#include "utils.hpp"
+
+// alternative to Jr3 that decodes frames from GPIO edge interrupts instead of busy-waiting on the port,
+// the calling thread sleeps in readFrame() until the interrupt handler has assembled a whole frame;
+// only ports 0 and 2 can raise GPIO interrupts on the LPC17xx, both share the EINT3 vector, therefore
+// this class can not coexist with mbed::InterruptIn instances nor with other Jr3Interrupt objects;
+// it has not been shown to keep up with the nominal link clock of about 1.25 MHz (see README), hence
+// it is only available for evaluation on slower links if JR3_INTERRUPT_EXPERIMENTAL is set to a non-zero
+// value (e.g. via mbed_app.json macros)
+
+#ifndef JR3_INTERRUPT_EXPERIMENTAL
+#define JR3_INTERRUPT_EXPERIMENTAL 0
+#endif
+
+#if !JR3_INTERRUPT_EXPERIMENTAL
+#error "Jr3Interrupt is experimental and not suitable for the nominal JR3 clock rate, use Jr3 or Jr3Ssp instead"
+#endif
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+class Jr3Interrupt
+{
+    static_assert(portName == Port0 || portName == Port2, "GPIO interrupts are only available on ports 0 and 2");
+
+public:
+    Jr3Interrupt();
+    ~Jr3Interrupt();
+    uint32_t readFrame();
+
+    // same as readFrame(), but gives up after the given time (rounded up to the RTOS tick)
+    // and returns JR3_INVALID_FRAME
+    uint32_t tryReadFrame(uint32_t timeoutUs);
+
+    static constexpr uint32_t CONNECTION_TIMEOUT_US = 100;
+    bool isConnected(uint32_t timeoutUs = CONNECTION_TIMEOUT_US) const;
+
+    uint32_t getFalseStartPulses() const
+    { return decoder.getFalseStartPulses(); }
+
+    uint32_t getQueueOverruns() const
+    { return queueOverruns; }
+
+private:
+    using PortAccess = Lpc17xxPortAccess<portName, clockPin, dataPin>;
+
+    static constexpr uint32_t CLOCK_MASK = PortAccess::CLOCK_MASK;
+    static constexpr uint32_t DATA_MASK = PortAccess::DATA_MASK;
+    static constexpr std::size_t QUEUE_SIZE = 16; // frames
+
+    static void irqHandler();
+    void handleEdges();
+    void updateEdgeMask();
+
+    PortAccess port;
+    volatile uint32_t * int_en_rising;
+    volatile uint32_t * int_en_falling;
+    volatile const uint32_t * int_stat_rising;
+    volatile const uint32_t * int_stat_falling;
+    volatile uint32_t * int_clear;
+
+    Jr3FrameDecoder decoder;
+    RingBuffer<uint32_t, QUEUE_SIZE> frames;
+    rtos::Semaphore available {0};
+    volatile uint32_t edgeCount {0};
+    volatile uint32_t queueOverruns {0};
+
+    static Jr3Interrupt * instance;
+};
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+Jr3Interrupt<portName, clockPin, dataPin> * Jr3Interrupt<portName, clockPin, dataPin>::instance = nullptr;
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+inline Jr3Interrupt<portName, clockPin, dataPin>::Jr3Interrupt()
+{
+    if (portName == Port0)
+    {
+        int_en_rising = &LPC_GPIOINT->IO0IntEnR;
+        int_en_falling = &LPC_GPIOINT->IO0IntEnF;
+        int_stat_rising = &LPC_GPIOINT->IO0IntStatR;
+        int_stat_falling = &LPC_GPIOINT->IO0IntStatF;
+        int_clear = &LPC_GPIOINT->IO0IntClr;
+    }
+    else
+    {
+        int_en_rising = &LPC_GPIOINT->IO2IntEnR;
+        int_en_falling = &LPC_GPIOINT->IO2IntEnF;
+        int_stat_rising = &LPC_GPIOINT->IO2IntStatR;
+        int_stat_falling = &LPC_GPIOINT->IO2IntStatF;
+        int_clear = &LPC_GPIOINT->IO2IntClr;
+    }
+
+    instance = this;
+
+    *int_clear = CLOCK_MASK | DATA_MASK;
+    updateEdgeMask();
+
+    NVIC_SetVector(EINT3_IRQn, reinterpret_cast<uint32_t>(&Jr3Interrupt::irqHandler));
+    NVIC_EnableIRQ(EINT3_IRQn);
+}
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+inline Jr3Interrupt<portName, clockPin, dataPin>::~Jr3Interrupt()
+{
+    NVIC_DisableIRQ(EINT3_IRQn);
+
+    *int_en_rising &= ~(CLOCK_MASK | DATA_MASK);
+    *int_en_falling &= ~(CLOCK_MASK | DATA_MASK);
+    *int_clear = CLOCK_MASK | DATA_MASK;
+
+    instance = nullptr;
+}
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+inline uint32_t Jr3Interrupt<portName, clockPin, dataPin>::readFrame()
+{
+    uint32_t frame;
+
+    do
+    {
+        available.acquire(); // sleep until the interrupt handler has assembled a frame
+    }
+    while (!frames.pop(frame));
+
+    return frame;
+}
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+inline uint32_t Jr3Interrupt<portName, clockPin, dataPin>::tryReadFrame(uint32_t timeoutUs)
+{
+    const auto timeout = std::chrono::milliseconds((timeoutUs + 999) / 1000);
+    uint32_t frame;
+
+    do
+    {
+        if (!available.try_acquire_for(timeout))
+        {
+            return JR3_INVALID_FRAME;
+        }
+    }
+    while (!frames.pop(frame));
+
+    return frame;
+}
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+inline bool Jr3Interrupt<portName, clockPin, dataPin>::isConnected(uint32_t timeoutUs) const
+{
+    // determine that the sensor is connected by detecting any edge on the enabled signals,
+    // start pulses are emitted at a much higher rate than this
+    const uint32_t initial = edgeCount;
+    const uint32_t start = us_ticker_read();
+
+    // return as soon as there is any activity
+    while (edgeCount == initial && us_ticker_read() - start < timeoutUs) {}
+
+    return edgeCount != initial;
+}
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+void Jr3Interrupt<portName, clockPin, dataPin>::irqHandler()
+{
+    if (instance)
+    {
+        instance->handleEdges();
+    }
+}
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+inline void Jr3Interrupt<portName, clockPin, dataPin>::handleEdges()
+{
+    // sample the pins first, as close to the triggering edge as possible; this still happens after the
+    // interrupt latency, i.e. the data bit must remain stable for that long after the rising clock edge
+    const uint32_t pins = port.read();
+    const uint32_t rising = *int_stat_rising & (CLOCK_MASK | DATA_MASK);
+    const uint32_t falling = *int_stat_falling & (CLOCK_MASK | DATA_MASK);
+    const bool clockEdges = decoder.wantsClockEdges();
+    const bool dataEdges = decoder.wantsDataEdges();
+    uint32_t frame;
+
+    *int_clear = rising | falling;
+    edgeCount = edgeCount + 1;
+
+    // beware of the order: a start pulse could be shorter than the interrupt latency,
+    // data edges never complete a frame
+    if (falling & DATA_MASK)
+    {
+        decoder.push(Jr3FrameDecoder::DATA_FALLING, pins & CLOCK_MASK, frame);
+    }
+
+    if (rising & DATA_MASK)
+    {
+        decoder.push(Jr3FrameDecoder::DATA_RISING, pins & CLOCK_MASK, frame);
+    }
+
+    if ((rising & CLOCK_MASK) && decoder.push(Jr3FrameDecoder::CLOCK_RISING, pins & DATA_MASK, frame))
+    {
+        if (frames.push(frame))
+        {
+            available.release();
+        }
+        else
+        {
+            queueOverruns = queueOverruns + 1;
+        }
+    }
+
+    // the mask only changes on state transitions of the decoder, i.e. a few times per frame
+    if (decoder.wantsClockEdges() != clockEdges || decoder.wantsDataEdges() != dataEdges)
+    {
+        updateEdgeMask();
+    }
+}
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+inline void Jr3Interrupt<portName, clockPin, dataPin>::updateEdgeMask()
+{
+    // listen only to the edges that the decoder cares about in its current state, this halves
+    // the interrupt rate while reading bits (data transitions are ignored then)
+    const uint32_t rising = (decoder.wantsClockEdges() ? CLOCK_MASK : 0) | (decoder.wantsDataEdges() ? DATA_MASK : 0);
+    const uint32_t falling = decoder.wantsDataEdges() ? DATA_MASK : 0;
+
+    *int_en_rising = (*int_en_rising & ~(CLOCK_MASK | DATA_MASK)) | rising;
+    *int_en_falling = (*int_en_falling & ~(CLOCK_MASK | DATA_MASK)) | falling;
+}
+
+#endif // __JR3_INTERRUPT_HPP__
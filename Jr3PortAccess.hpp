@@ -0,0 +1,88 @@
+#ifndef __JR3_PORT_ACCESS_HPP__
+#define __JR3_PORT_ACCESS_HPP__
+
+#include "mbed.h"
+
+// port access policies for Jr3Reader, both signals must be wired to the same port so that
+// they can be sampled at once with a single register read
+
+#if defined(TARGET_LPC176X)
+
+#include "LPC17xx.h"
+
+// reimplemented from: https://github.com/ARMmbed/mbed-os/blob/f9c0cd2/targets/TARGET_NXP/TARGET_LPC176X/port_api.c
+// inspiration: https://os.mbed.com/users/igorsk/notebook/fast-gpio-with-c-templates/
+
+template <PortName portName, PinName clockPin, PinName dataPin>
+class Lpc17xxPortAccess
+{
+public:
+    static constexpr uint32_t CLOCK_MASK = 1UL << ((clockPin - P0_0) % 32);
+    static constexpr uint32_t DATA_MASK = 1UL << ((dataPin - P0_0) % 32);
+
+    Lpc17xxPortAccess()
+    {
+        auto * port_reg = reinterpret_cast<LPC_GPIO_TypeDef *>(LPC_GPIO0_BASE + ((int)portName * 0x20));
+
+        for (int i = 0; i < 32; i++)
+        {
+            if ((CLOCK_MASK | DATA_MASK) & (1UL << i))
+            {
+                gpio_set(port_pin(portName, i));
+            }
+        }
+
+        port_reg->FIODIR &= ~(CLOCK_MASK | DATA_MASK); // input
+        port_in = &port_reg->FIOPIN;
+
+        us_ticker_read(); // make sure that the us ticker is running, see nowUs()
+    }
+
+    uint32_t read() const
+    { return *port_in; }
+
+    // the us ticker runs on TIMER3 on this target, reading its counter directly is as cheap as a port read
+    uint32_t nowUs() const
+    { return LPC_TIM3->TC; }
+
+private:
+    volatile uint32_t * port_in;
+};
+
+#endif // TARGET_LPC176X
+
+#if defined(TARGET_STM)
+
+template <PinName clockPin, PinName dataPin>
+class Stm32PortAccess
+{
+    static_assert(STM_PORT(clockPin) == STM_PORT(dataPin), "clock and data pins must belong to the same port");
+
+public:
+    static constexpr uint32_t CLOCK_MASK = 1UL << STM_PIN(clockPin);
+    static constexpr uint32_t DATA_MASK = 1UL << STM_PIN(dataPin);
+
+    Stm32PortAccess()
+    {
+        gpio_t clock, data;
+
+        // enables the port clock and configures both pins as inputs
+        gpio_init_in_ex(&clock, clockPin, PullUp);
+        gpio_init_in_ex(&data, dataPin, PullUp);
+
+        port_in = &clock.gpio->IDR;
+    }
+
+    uint32_t read() const
+    { return *port_in; }
+
+    uint32_t nowUs() const
+    { return us_ticker_read(); }
+
+private:
+    volatile uint32_t * port_in;
+};
+
+#endif // TARGET_STM
+
+#endif // __JR3_PORT_ACCESS_HPP__
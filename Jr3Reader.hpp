@@ -0,0 +1,245 @@
+#ifndef __JR3_READER_HPP__
+#define __JR3_READER_HPP__
+
+#include "cstdint"
+#include "utility"
+#include "utils.hpp"
+
+// busy-wait frame decoder, independent of the target platform: all accesses to the clock and data pins
+// go through the PortAccess policy, which must provide the following members:
+//  - static constexpr uint32_t CLOCK_MASK, DATA_MASK: bit masks of both signals within the port value
+//  - uint32_t read() const: current value of the input port (only masked bits are inspected)
+//  - uint32_t nowUs() const: free-running microsecond counter (wraps around), used for timeouts only
+// see Jr3PortAccess.hpp for the on-target policies and Jr3HostPortAccess.hpp for a waveform player
+
+template <typename PortAccess>
+class Jr3Reader
+{
+public:
+    // arguments (if any) are forwarded to the port access policy
+    template <typename... Args>
+    explicit Jr3Reader(Args &&... args) : port(std::forward<Args>(args)...)
+    {}
+
+    uint32_t readFrame() const;
+
+    // same as readFrame(), but gives up after the given time and returns JR3_INVALID_FRAME
+    uint32_t tryReadFrame(uint32_t timeoutUs) const;
+
+    static constexpr uint32_t CONNECTION_TIMEOUT_US = 1000;
+    static constexpr unsigned int CONNECTION_EDGES = 256; // about ten frames
+
+    // looks for clock transitions during the given time, returns as soon as enough of them have been seen
+    bool isConnected(uint32_t timeoutUs = CONNECTION_TIMEOUT_US) const;
+
+    // clock transitions per second observed during the last call to isConnected()
+    uint32_t getEdgeRate() const
+    { return edgeRate; }
+
+    // number of signal transitions that looked like the beginning of a start pulse, but were not
+    uint32_t getFalseStartPulses() const
+    { return falseStartPulses; }
+
+    const PortAccess & getPortAccess() const
+    { return port; }
+
+private:
+    enum pin_state : uint32_t
+    {
+        DATA_LOW_CLOCK_LOW = 0,
+        DATA_LOW_CLOCK_HIGH = PortAccess::CLOCK_MASK,
+        DATA_HIGH_CLOCK_LOW = PortAccess::DATA_MASK,
+        // we can use the next one as the pin mask for port-related stuff
+        DATA_HIGH_CLOCK_HIGH = PortAccess::CLOCK_MASK | PortAccess::DATA_MASK
+    };
+
+    template <bool bounded>
+    uint32_t readFrameInternal() const;
+
+    template <bool bounded>
+    bool awaitNextFrame() const;
+
+    template <bool bounded>
+    bool expired() const;
+
+    pin_state readPins() const;
+    bool readClock() const;
+    bool readData() const;
+
+    PortAccess port;
+    mutable uint32_t falseStartPulses {0};
+    mutable uint32_t edgeRate {0};
+
+    // timeout bookkeeping, only used by tryReadFrame()
+    mutable uint32_t startUs {0};
+    mutable uint32_t timeoutUs {0};
+    mutable uint32_t polls {0};
+    mutable bool timedOut {false};
+
+    static constexpr unsigned int FRAME_SIZE = 20;
+};
+
+template <typename PortAccess>
+inline uint32_t Jr3Reader<PortAccess>::readFrame() const
+{
+    return readFrameInternal<false>();
+}
+
+template <typename PortAccess>
+inline uint32_t Jr3Reader<PortAccess>::tryReadFrame(uint32_t timeout) const
+{
+    startUs = port.nowUs();
+    timeoutUs = timeout;
+    polls = 0;
+    timedOut = false;
+
+    return readFrameInternal<true>();
+}
+
+template <typename PortAccess>
+template <bool bounded>
+inline bool Jr3Reader<PortAccess>::expired() const
+{
+    if (!bounded)
+    {
+        return false; // optimized away, the unbounded busy loops stay as tight as possible
+    }
+
+    // reading the timer on every poll would slow down sampling too much
+    if ((++polls & 0x3F) == 0 && port.nowUs() - startUs >= timeoutUs)
+    {
+        timedOut = true;
+    }
+
+    return timedOut;
+}
+
+template <typename PortAccess>
+template <bool bounded>
+inline uint32_t Jr3Reader<PortAccess>::readFrameInternal() const
+{
+    pin_state pins;
+    uint32_t frame = 0;
+
+    if (!awaitNextFrame<bounded>())
+    {
+        return JR3_INVALID_FRAME;
+    }
+
+    for (int i = FRAME_SIZE - 1; i >= 0; i--)
+    {
+        // await end of previous bit, if necessary
+        while (readClock() && !expired<bounded>()) {}
+
+        // await rising edge on clock signal
+        while (((pins = readPins()) & DATA_LOW_CLOCK_HIGH) == 0 && !expired<bounded>()) {}
+
+        if (bounded && timedOut)
+        {
+            return JR3_INVALID_FRAME; // the sensor went away in the middle of a frame
+        }
+
+        if ((pins & DATA_HIGH_CLOCK_LOW) == DATA_HIGH_CLOCK_LOW)
+        {
+            frame |= (1U << i);
+        }
+    }
+
+    return frame;
+}
+
+template <typename PortAccess>
+template <bool bounded>
+inline bool Jr3Reader<PortAccess>::awaitNextFrame() const
+{
+    pin_state pins;
+
+    while (true)
+    {
+        // await next interval between frames
+        while (readPins() != DATA_HIGH_CLOCK_HIGH && !expired<bounded>()) {}
+
+        // await beginning of start pulse
+        while ((pins = readPins()) == DATA_HIGH_CLOCK_HIGH && !expired<bounded>()) {}
+
+        if (bounded && timedOut)
+        {
+            return false;
+        }
+
+        if (pins != DATA_LOW_CLOCK_HIGH)
+        {
+            falseStartPulses++;
+            continue; // this is not a start pulse, retry
+        }
+
+        // await rising edge of start pulse
+        while ((pins = readPins()) == DATA_LOW_CLOCK_HIGH && !expired<bounded>()) {}
+
+        if (bounded && timedOut)
+        {
+            return false;
+        }
+
+        if (pins != DATA_HIGH_CLOCK_HIGH)
+        {
+            falseStartPulses++;
+            continue; // this is not a start pulse, retry
+        }
+
+        return true; // start pulse completed, we can start processing a new frame
+    }
+}
+
+template <typename PortAccess>
+inline typename Jr3Reader<PortAccess>::pin_state Jr3Reader<PortAccess>::readPins() const
+{
+    return static_cast<pin_state>(port.read() & DATA_HIGH_CLOCK_HIGH);
+}
+
+template <typename PortAccess>
+inline bool Jr3Reader<PortAccess>::readClock() const
+{
+    return port.read() & DATA_LOW_CLOCK_HIGH;
+}
+
+template <typename PortAccess>
+inline bool Jr3Reader<PortAccess>::readData() const
+{
+    return port.read() & DATA_HIGH_CLOCK_LOW;
+}
+
+template <typename PortAccess>
+inline bool Jr3Reader<PortAccess>::isConnected(uint32_t timeoutUs) const
+{
+    // determine that the sensor is connected by detecting rising and falling edges on the clock signal;
+    // the timeout is measured with a timer, hence it does not depend on the CPU clock frequency
+    const uint32_t start = port.nowUs();
+    bool level = readClock();
+    unsigned int edges = 0;
+    uint32_t n = 0;
+
+    while (edges < CONNECTION_EDGES)
+    {
+        const bool current = readClock();
+
+        if (current != level)
+        {
+            level = current;
+            edges++;
+        }
+
+        // reading the timer on every poll would make us miss edges
+        if ((++n & 0x3F) == 0 && port.nowUs() - start >= timeoutUs)
+        {
+            break;
+        }
+    }
+
+    const uint32_t elapsed = port.nowUs() - start;
+    edgeRate = elapsed != 0 ? (static_cast<uint64_t>(edges) * 1000000) / elapsed : 0;
+
+    return edges >= 2; // a whole clock pulse, not just a glitch
+}
+
+#endif // __JR3_READER_HPP__
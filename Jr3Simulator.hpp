@@ -0,0 +1,341 @@
+#ifndef __JR3_SIMULATOR_HPP__
+#define __JR3_SIMULATOR_HPP__
+
+#include "cmath"
+#include "cstdint"
+#include "cstring"
+#include "functional"
+#include "random"
+
+#if defined(__MBED__)
+#include "mbed.h"
+#else
+#include "chrono"
+#endif
+
+// software replacement of a JR3 sensor that produces the same frame sequence as the real device:
+// voltage (channel 0), raw forces and moments (channels 1-6) and one byte of the calibration EEPROM
+// (channel 7) per frame set; plug it into the controller in place of a Jr3 reader:
+//
+//     Jr3Simulator simulator;
+//     Jr3Controller controller({&simulator, &Jr3Simulator::nextFrame});
+//
+// wrench trajectories are expressed in N and N*m, raw values are obtained by inverting the calibration
+// matrix, therefore the controller should report the requested wrench back (see README for scaling)
+
+class Jr3Simulator
+{
+public:
+    enum pacing
+    { AS_FAST_AS_POSSIBLE, REAL_TIME };
+
+    // time [s] since the first frame, output: fx, fy, fz [N], mx, my, mz [N*m]
+    using Trajectory = std::function<void(double, double *)>;
+
+    struct statistics
+    {
+        uint64_t frames; // emitted, including corrupted ones
+        uint64_t droppedFrames;
+        uint64_t corruptedFrames;
+        uint64_t frameSets;
+    };
+
+    Jr3Simulator(uint32_t seed = 0)
+        : random(seed)
+    {
+        static const double identity[36] = {
+            1, 0, 0, 0, 0, 0,
+            0, 1, 0, 0, 0, 0,
+            0, 0, 1, 0, 0, 0,
+            0, 0, 0, 1, 0, 0,
+            0, 0, 0, 0, 1, 0,
+            0, 0, 0, 0, 0, 1
+        };
+
+        static const uint16_t defaultFullScales[6] = {1000, 1000, 2000, 100, 100, 100};
+
+        setCalibration(identity, defaultFullScales);
+    }
+
+    // row-major 6x6 matrix, coefficients must be zero or lie within [2^-16, 1] in magnitude, which is what the
+    // firmware can parse (see jr3ToFixedPoint()); also regenerates the EEPROM image, returns false and keeps
+    // the current calibration otherwise
+    bool setCalibration(const double * matrix, const uint16_t * scales);
+
+    void setTrajectory(Trajectory cb)
+    { trajectory = cb; }
+
+    // standard deviation of the gaussian noise added to raw channels [sensor counts]
+    void setNoise(double stddev)
+    { noise = stddev; }
+
+    // probability of a frame being silently skipped or of a random bit being flipped
+    void setFaults(double dropProbability, double corruptionProbability)
+    { dropRate = dropProbability; corruptionRate = corruptionProbability; }
+
+    void setPacing(pacing mode)
+    { pace = mode; }
+
+    void setVoltage(uint16_t value)
+    { voltage = value; }
+
+    uint32_t nextFrame();
+    void reset();
+
+    statistics getStatistics() const
+    { return stats; }
+
+    const uint8_t * getEeprom() const
+    { return eeprom; }
+
+    static constexpr double FRAME_SET_PERIOD = 128.5e-6; // [s]
+    static constexpr int CHANNELS = 8;
+    static constexpr int MIN_EXPONENT = -15; // the firmware shifts mantissas left by (15 + exponent) bits
+
+private:
+    void computeRawValues();
+    uint32_t buildFrame(uint8_t channel);
+    void awaitFrameTime();
+
+    static uint64_t nowUs()
+    {
+#if defined(__MBED__)
+        return ticker_read_us(get_us_ticker_data());
+#else
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    std::mt19937 random;
+    Trajectory trajectory;
+    pacing pace {AS_FAST_AS_POSSIBLE};
+    double noise {0.0};
+    double dropRate {0.0};
+    double corruptionRate {0.0};
+    uint16_t voltage {0};
+
+    double inverse[36] {}; // maps output counts to raw counts
+    double countsPerUnit[6] {}; // from full scales
+    uint8_t eeprom[256] {};
+    int16_t raw[6] {};
+
+    uint8_t channel {0};
+    uint8_t eepromAddress {0};
+    uint64_t frameIndex {0};
+    uint64_t startUs {0};
+    statistics stats {};
+};
+
+inline bool Jr3Simulator::setCalibration(const double * matrix, const uint16_t * scales)
+{
+    uint16_t mantissas[36];
+    int8_t exponents[36];
+
+    for (int i = 0; i < 36; i++)
+    {
+        int exponent;
+        const double fraction = std::frexp(matrix[i], &exponent); // |fraction| in [0.5, 1)
+        long mantissa = std::lround(std::ldexp(fraction, 15));
+
+        if (mantissa > 32767 || mantissa < -32768)
+        {
+            mantissa /= 2;
+            exponent++;
+        }
+
+        if (fraction == 0.0)
+        {
+            exponent = 0;
+        }
+        else if (exponent < MIN_EXPONENT || std::fabs(matrix[i]) > 1.0)
+        {
+            return false;
+        }
+
+        mantissas[i] = static_cast<uint16_t>(mantissa);
+        exponents[i] = static_cast<int8_t>(exponent);
+    }
+
+    std::memset(eeprom, 0, sizeof(eeprom));
+
+    // same layout as parsed by jr3ParseCalibration()
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            std::memcpy(eeprom + 10 + (i * 20) + (j * 3), mantissas + (i * 6) + j, sizeof(uint16_t));
+            std::memcpy(eeprom + 12 + (i * 20) + (j * 3), exponents + (i * 6) + j, sizeof(int8_t));
+        }
+
+        std::memcpy(eeprom + 28 + (i * 20), scales + i, sizeof(uint16_t));
+
+        // see README: outgoing values are multiplied by the full scale and divided by 2^14 (*10 for moments)
+        countsPerUnit[i] = (i < 3 ? 16384.0 : 163840.0) / scales[i];
+    }
+
+    // the firmware negates both the coefficients and the raw values on parsing, and the result on output,
+    // hence output = -(C * raw) and raw = -(C^-1 * output); invert by Gauss-Jordan elimination
+    double work[36];
+    std::memcpy(work, matrix, sizeof(work));
+
+    for (int i = 0; i < 36; i++)
+    {
+        inverse[i] = (i % 7 == 0) ? -1.0 : 0.0;
+    }
+
+    for (int col = 0; col < 6; col++)
+    {
+        int pivot = col;
+
+        for (int row = col + 1; row < 6; row++)
+        {
+            if (std::fabs(work[(row * 6) + col]) > std::fabs(work[(pivot * 6) + col]))
+            {
+                pivot = row;
+            }
+        }
+
+        for (int k = 0; k < 6; k++)
+        {
+            std::swap(work[(col * 6) + k], work[(pivot * 6) + k]);
+            std::swap(inverse[(col * 6) + k], inverse[(pivot * 6) + k]);
+        }
+
+        const double diagonal = work[(col * 6) + col];
+
+        for (int k = 0; k < 6; k++)
+        {
+            work[(col * 6) + k] /= diagonal;
+            inverse[(col * 6) + k] /= diagonal;
+        }
+
+        for (int row = 0; row < 6; row++)
+        {
+            if (row != col)
+            {
+                const double factor = work[(row * 6) + col];
+
+                for (int k = 0; k < 6; k++)
+                {
+                    work[(row * 6) + k] -= factor * work[(col * 6) + k];
+                    inverse[(row * 6) + k] -= factor * inverse[(col * 6) + k];
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+inline uint32_t Jr3Simulator::nextFrame()
+{
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    while (true)
+    {
+        const uint8_t current = channel;
+
+        if (pace == REAL_TIME)
+        {
+            awaitFrameTime();
+        }
+
+        if (current == 0)
+        {
+            computeRawValues();
+        }
+
+        uint32_t frame = buildFrame(current);
+
+        channel = (channel + 1) % CHANNELS;
+        frameIndex++;
+
+        if (channel == 0)
+        {
+            stats.frameSets++;
+        }
+
+        if (dropRate > 0.0 && uniform(random) < dropRate)
+        {
+            stats.droppedFrames++;
+            continue; // lost on the wire, the receiver will see the next one
+        }
+
+        if (corruptionRate > 0.0 && uniform(random) < corruptionRate)
+        {
+            frame ^= 1UL << std::uniform_int_distribution<int>(0, 19)(random);
+            stats.corruptedFrames++;
+        }
+
+        stats.frames++;
+        return frame;
+    }
+}
+
+inline void Jr3Simulator::reset()
+{
+    channel = 0;
+    eepromAddress = 0;
+    frameIndex = 0;
+    startUs = 0;
+    stats = {};
+}
+
+inline void Jr3Simulator::computeRawValues()
+{
+    const double t = (frameIndex / CHANNELS) * FRAME_SET_PERIOD;
+    double wrench[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    std::normal_distribution<double> gaussian(0.0, noise > 0.0 ? noise : 1.0);
+
+    if (trajectory)
+    {
+        trajectory(t, wrench);
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        double value = noise > 0.0 ? gaussian(random) : 0.0;
+
+        for (int j = 0; j < 6; j++)
+        {
+            value += inverse[(i * 6) + j] * wrench[j] * countsPerUnit[j];
+        }
+
+        raw[i] = static_cast<int16_t>(std::fmax(-32768.0, std::fmin(32767.0, std::round(value))));
+    }
+}
+
+inline uint32_t Jr3Simulator::buildFrame(uint8_t current)
+{
+    uint16_t data;
+
+    switch (current)
+    {
+    case 0:
+        data = voltage;
+        break;
+    case 7:
+        data = (eepromAddress << 8) | eeprom[eepromAddress];
+        eepromAddress++; // wraps around after 256 bytes
+        break;
+    default:
+        data = static_cast<uint16_t>(raw[current - 1]);
+        break;
+    }
+
+    return (static_cast<uint32_t>(current) << 16) | data;
+}
+
+inline void Jr3Simulator::awaitFrameTime()
+{
+    if (frameIndex == 0)
+    {
+        startUs = nowUs();
+    }
+
+    const uint64_t due = startUs + static_cast<uint64_t>(frameIndex * (FRAME_SET_PERIOD * 1e6) / CHANNELS);
+
+    while (nowUs() < due) {}
+}
+
+#endif // __JR3_SIMULATOR_HPP__
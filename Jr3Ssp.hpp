@@ -0,0 +1,217 @@
+#ifndef __JR3_SSP_HPP__
+#define __JR3_SSP_HPP__
+
+#include "mbed.h"
+#include "LPC17xx.h"
+#include "Jr3FrameAligner.hpp"
+#include "RingBuffer.hpp"
+#include "utils.hpp"
+
+// alternative to Jr3 that lets an SSP block in SPI slave mode shift the bitstream in, the CPU is only
+// involved when the receive FIFO is half full, the received words are realigned into frames by Jr3FrameAligner;
+// connect the JR3 clock to SCK and the JR3 data to MOSI, the SSEL pin must be tied to ground
+// see UM10360, chapter 18: LPC17xx SSP0/1 interface
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+class Jr3Ssp
+{
+    static_assert((clockPin == P0_15 && dataPin == P0_18 && selectPin == P0_16) || // SSP0: p13, p11, p14
+                  (clockPin == P0_7 && dataPin == P0_9 && selectPin == P0_6), // SSP1: p7, p5, p8
+                  "pins must match either the SSP0 or the SSP1 SCK/MOSI/SSEL functions on port 0");
+
+public:
+    Jr3Ssp();
+    ~Jr3Ssp();
+    uint32_t readFrame();
+
+    // same as readFrame(), but gives up after the given time (rounded up to the RTOS tick)
+    // and returns JR3_INVALID_FRAME
+    uint32_t tryReadFrame(uint32_t timeoutUs);
+
+    static constexpr uint32_t CONNECTION_TIMEOUT_US = 200;
+    bool isConnected(uint32_t timeoutUs = CONNECTION_TIMEOUT_US) const;
+
+    uint32_t getResynchronizations() const
+    { return aligner.getResynchronizations(); }
+
+    uint32_t getReceiveOverruns() const
+    { return receiveOverruns; }
+
+    uint32_t getQueueOverruns() const
+    { return queueOverruns; }
+
+private:
+    static constexpr bool USE_SSP0 = clockPin == P0_15;
+    static constexpr IRQn_Type IRQ_NUMBER = USE_SSP0 ? SSP0_IRQn : SSP1_IRQn;
+    static constexpr std::size_t QUEUE_SIZE = 16; // frames
+
+    // register bits
+    static constexpr uint32_t CR0_DSS_16BIT = 0x0F;
+    static constexpr uint32_t CR0_CPOL = 1UL << 6; // clock idles high
+    static constexpr uint32_t CR0_CPHA = 1UL << 7; // capture on the second (rising) edge
+    static constexpr uint32_t CR1_SSE = 1UL << 1;
+    static constexpr uint32_t CR1_MS = 1UL << 2; // slave mode
+    static constexpr uint32_t CR1_SOD = 1UL << 3; // slave output disable, MISO is left untouched
+    static constexpr uint32_t SR_RNE = 1UL << 2;
+    static constexpr uint32_t INT_ROR = 1UL << 0;
+    static constexpr uint32_t INT_RT = 1UL << 1;
+    static constexpr uint32_t INT_RX = 1UL << 2;
+
+    static void irqHandler();
+    void handleReceive();
+
+    LPC_SSP_TypeDef * ssp;
+    Jr3FrameAligner aligner;
+    RingBuffer<uint32_t, QUEUE_SIZE> frames;
+    rtos::Semaphore available {0};
+    volatile uint32_t wordCount {0};
+    volatile uint32_t receiveOverruns {0};
+    volatile uint32_t queueOverruns {0};
+
+    static Jr3Ssp * instance;
+};
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+Jr3Ssp<clockPin, dataPin, selectPin> * Jr3Ssp<clockPin, dataPin, selectPin>::instance = nullptr;
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+inline Jr3Ssp<clockPin, dataPin, selectPin>::Jr3Ssp()
+{
+    if (USE_SSP0)
+    {
+        ssp = LPC_SSP0;
+        LPC_SC->PCONP |= 1UL << 21;
+    }
+    else
+    {
+        ssp = LPC_SSP1;
+        LPC_SC->PCONP |= 1UL << 10;
+    }
+
+    // slave mode requires PCLK to be at least 12 times faster than the JR3 clock (about 1.25 MHz), which
+    // the reset divider already provides (CCLK/4, i.e. 24 MHz at 96 MHz); PCLKSEL0/1 are left untouched,
+    // since they must not be changed while PLL0 is connected (LPC176x errata, PCLKSELx.1)
+    pin_function(clockPin, 2);
+    pin_function(dataPin, 2);
+    pin_function(selectPin, 2);
+
+    ssp->CR1 = 0;
+    ssp->CR0 = CR0_DSS_16BIT | CR0_CPOL | CR0_CPHA; // SPI frame format
+    ssp->CPSR = 2; // unused in slave mode, yet it must hold a valid value
+
+    while (ssp->SR & SR_RNE)
+    {
+        (void)ssp->DR; // flush stale data
+    }
+
+    instance = this;
+
+    ssp->ICR = INT_ROR | INT_RT;
+    ssp->IMSC = INT_ROR | INT_RT | INT_RX;
+    ssp->CR1 = CR1_MS | CR1_SOD; // the mode must be selected prior to enabling the peripheral
+    ssp->CR1 |= CR1_SSE;
+
+    NVIC_SetVector(IRQ_NUMBER, reinterpret_cast<uint32_t>(&Jr3Ssp::irqHandler));
+    NVIC_EnableIRQ(IRQ_NUMBER);
+}
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+inline Jr3Ssp<clockPin, dataPin, selectPin>::~Jr3Ssp()
+{
+    NVIC_DisableIRQ(IRQ_NUMBER);
+
+    ssp->IMSC = 0;
+    ssp->CR1 = 0;
+
+    instance = nullptr;
+}
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+inline uint32_t Jr3Ssp<clockPin, dataPin, selectPin>::readFrame()
+{
+    uint32_t frame;
+
+    do
+    {
+        available.acquire(); // sleep until the interrupt handler has realigned a frame
+    }
+    while (!frames.pop(frame));
+
+    return frame;
+}
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+inline uint32_t Jr3Ssp<clockPin, dataPin, selectPin>::tryReadFrame(uint32_t timeoutUs)
+{
+    const auto timeout = std::chrono::milliseconds((timeoutUs + 999) / 1000);
+    uint32_t frame;
+
+    do
+    {
+        if (!available.try_acquire_for(timeout))
+        {
+            return JR3_INVALID_FRAME;
+        }
+    }
+    while (!frames.pop(frame));
+
+    return frame;
+}
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+inline bool Jr3Ssp<clockPin, dataPin, selectPin>::isConnected(uint32_t timeoutUs) const
+{
+    // determine that the sensor is connected by detecting incoming words, the receive timeout
+    // interrupt guarantees that partially filled FIFOs are drained as well
+    const uint32_t initial = wordCount;
+    const uint32_t start = us_ticker_read();
+
+    // return as soon as there is any activity
+    while (wordCount == initial && us_ticker_read() - start < timeoutUs) {}
+
+    return wordCount != initial;
+}
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+void Jr3Ssp<clockPin, dataPin, selectPin>::irqHandler()
+{
+    if (instance)
+    {
+        instance->handleReceive();
+    }
+}
+
+template <PinName clockPin, PinName dataPin, PinName selectPin>
+inline void Jr3Ssp<clockPin, dataPin, selectPin>::handleReceive()
+{
+    uint32_t frame;
+
+    if (ssp->MIS & INT_ROR)
+    {
+        // some bits were lost, frame boundaries must be recovered again
+        ssp->ICR = INT_ROR;
+        aligner.reset();
+        receiveOverruns = receiveOverruns + 1;
+    }
+
+    while (ssp->SR & SR_RNE)
+    {
+        wordCount = wordCount + 1;
+
+        if (aligner.push(ssp->DR, frame))
+        {
+            if (frames.push(frame))
+            {
+                available.release();
+            }
+            else
+            {
+                queueOverruns = queueOverruns + 1;
+            }
+        }
+    }
+
+    ssp->ICR = INT_RT;
+}
+
+#endif // __JR3_SSP_HPP__
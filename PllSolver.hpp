@@ -0,0 +1,117 @@
+#ifndef __PLL_SOLVER_HPP__
+#define __PLL_SOLVER_HPP__
+
+#include "cstdint"
+
+// PLL0 parameters of the LPC17xx family (see "Chapter 4: LPC17xx Clocking and power control" of the user
+// manual), independent of the target platform:
+//   Fcco = (2 * M * Fin) / N, with M in [6, 512], N in [1, 32] and Fcco in [275, 550] MHz
+//   CCLK = Fcco / CCLKDIV, with CCLKDIV in [2, 256] (no division is not allowed while PLL0 is connected)
+// the CPU clock is additionally capped at 128 MHz, the highest overclocking setting known to work on the
+// mbed LPC1768 (the datasheet specifies 100 MHz, or 120 MHz for the LPC1769)
+
+struct pll_config
+{
+    static constexpr uint32_t INPUT_HZ = 12000000; // 12 MHz XTAL on the mbed LPC1768
+    static constexpr uint32_t MIN_FCCO_HZ = 275000000;
+    static constexpr uint32_t MAX_FCCO_HZ = 550000000;
+    static constexpr uint32_t MAX_CCLK_HZ = 128000000;
+    static constexpr int MIN_M = 6;
+    static constexpr int MAX_M = 512;
+    static constexpr int MIN_N = 1;
+    static constexpr int MAX_N = 32;
+    static constexpr int MIN_CLK_DIV = 2;
+    static constexpr int MAX_CLK_DIV = 256;
+
+    int clkDiv;
+    int M;
+    int N;
+
+    uint32_t fcco(uint32_t inputHz = INPUT_HZ) const
+    {
+        return (2ULL * M * inputHz) / N;
+    }
+
+    uint32_t cclk(uint32_t inputHz = INPUT_HZ) const
+    {
+        return fcco(inputHz) / clkDiv;
+    }
+
+    bool isValid(uint32_t inputHz = INPUT_HZ) const
+    {
+        if (M < MIN_M || M > MAX_M || N < MIN_N || N > MAX_N || clkDiv < MIN_CLK_DIV || clkDiv > MAX_CLK_DIV)
+        {
+            return false;
+        }
+
+        const uint64_t f = (2ULL * M * inputHz) / N;
+        return f >= MIN_FCCO_HZ && f <= MAX_FCCO_HZ && f / clkDiv <= MAX_CCLK_HZ;
+    }
+
+    // value of the FLASHTIM field of FLASHCFG (flash access time in CPU clocks, minus one) required
+    // by the given CPU clock; the last one is the safe setting for any frequency
+    static uint32_t flashAccessTime(uint32_t cclkHz)
+    {
+        return cclkHz <= 20000000 ? 0 : cclkHz <= 40000000 ? 1 : cclkHz <= 60000000 ? 2
+             : cclkHz <= 80000000 ? 3 : cclkHz <= 100000000 ? 4 : 5;
+    }
+
+    // finds the valid configuration whose CPU clock is closest to targetHz (capped at MAX_CCLK_HZ), preferring
+    // the lowest N (less jitter, higher PLL comparison frequency) and then the lowest Fcco (less power) on ties;
+    // returns false if no valid configuration exists, e.g. for an input frequency out of range
+    static bool solve(uint32_t targetHz, pll_config & config, uint32_t inputHz = INPUT_HZ)
+    {
+        bool found = false;
+        uint32_t bestError = 0;
+
+        if (targetHz > MAX_CCLK_HZ)
+        {
+            targetHz = MAX_CCLK_HZ;
+        }
+
+        for (int n = MIN_N; n <= MAX_N; n++)
+        {
+            for (int m = MIN_M; m <= MAX_M; m++)
+            {
+                const uint64_t f = (2ULL * m * inputHz) / n;
+
+                if (f < MIN_FCCO_HZ)
+                {
+                    continue;
+                }
+
+                if (f > MAX_FCCO_HZ)
+                {
+                    break; // Fcco only grows with M
+                }
+
+                // the two nearest divisors around the exact ratio
+                const int lower = static_cast<int>(f / (targetHz ? targetHz : 1));
+
+                for (int d = lower; d <= lower + 1; d++)
+                {
+                    const int div = d < MIN_CLK_DIV ? MIN_CLK_DIV : (d > MAX_CLK_DIV ? MAX_CLK_DIV : d);
+                    const uint32_t cclk = f / div;
+
+                    if (cclk > MAX_CCLK_HZ)
+                    {
+                        continue; // the ratio was rounded down
+                    }
+
+                    const uint32_t error = cclk > targetHz ? cclk - targetHz : targetHz - cclk;
+
+                    if (!found || error < bestError)
+                    {
+                        config = {div, m, n};
+                        bestError = error;
+                        found = true;
+                    }
+                }
+            }
+        }
+
+        return found;
+    }
+};
+
+#endif // __PLL_SOLVER_HPP__
@@ -0,0 +1,154 @@
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include "cstdint"
+
+#if defined(__MBED__)
+#include "mbed.h"
+#else
+#include "chrono"
+#endif
+
+// per-stage timing instrumentation, compiled out unless JR3_PROFILING is set to a non-zero value
+// (e.g. via mbed_app.json macros); on target, ticks are CPU cycles counted by the DWT unit, whereas
+// host builds count nanoseconds of std::chrono::steady_clock
+
+#ifndef JR3_PROFILING
+#define JR3_PROFILING 0
+#endif
+
+class CycleCounter
+{
+public:
+    static void enable()
+    {
+#if defined(__MBED__)
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    }
+
+    // wraps around, only differences are meaningful
+    static uint32_t now()
+    {
+#if defined(__MBED__)
+        return DWT->CYCCNT;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static uint32_t ticksPerSecond()
+    {
+#if defined(__MBED__)
+        return SystemCoreClock;
+#else
+        return 1000000000UL;
+#endif
+    }
+};
+
+struct stage_stats
+{
+    uint32_t min;
+    uint32_t max;
+    uint32_t count;
+    uint64_t total; // mean = total / count
+
+    void record(uint32_t ticks)
+    {
+        min = (count == 0 || ticks < min) ? ticks : min;
+        max = ticks > max ? ticks : max;
+        total += ticks;
+        count++;
+    }
+};
+
+template <int STAGES>
+struct pipeline_stats
+{
+    stage_stats stages[STAGES];
+    uint32_t ticksPerSecond;
+};
+
+template <int STAGES>
+class PipelineProfiler
+{
+public:
+    PipelineProfiler()
+    {
+        reset();
+#if JR3_PROFILING
+        CycleCounter::enable();
+#endif
+    }
+
+    // sets the reference point for the next lap
+    void mark()
+    {
+#if JR3_PROFILING
+        last = CycleCounter::now();
+#endif
+    }
+
+    // accounts the time elapsed since the previous mark or lap to the given stage
+    void lap(int stage)
+    {
+#if JR3_PROFILING
+        const uint32_t current = CycleCounter::now();
+        stats.stages[stage].record(pending[stage] + (current - last));
+        pending[stage] = 0;
+        last = current;
+#else
+        (void)stage;
+#endif
+    }
+
+    // same as lap(), but the time is only recorded along with the next lap() of the same stage, so that a stage
+    // spread over several iterations (e.g. once per frame, recorded once per frame set) counts as one
+    void split(int stage)
+    {
+#if JR3_PROFILING
+        const uint32_t current = CycleCounter::now();
+        pending[stage] += current - last;
+        last = current;
+#else
+        (void)stage;
+#endif
+    }
+
+    // drops the time accumulated by split() calls, e.g. when an incomplete frame set is thrown away
+    void discard(int stage)
+    {
+#if JR3_PROFILING
+        pending[stage] = 0;
+#else
+        (void)stage;
+#endif
+    }
+
+    void reset()
+    {
+        stats = {};
+#if JR3_PROFILING
+        for (auto & ticks : pending)
+        {
+            ticks = 0;
+        }
+#endif
+        stats.ticksPerSecond = CycleCounter::ticksPerSecond();
+    }
+
+    const pipeline_stats<STAGES> & getStats() const
+    { return stats; }
+
+private:
+    pipeline_stats<STAGES> stats;
+    uint32_t last {0};
+#if JR3_PROFILING
+    uint32_t pending[STAGES]; // see split()
+#endif
+};
+
+#endif // __PROFILER_HPP__
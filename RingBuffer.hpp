@@ -0,0 +1,75 @@
+#ifndef __RING_BUFFER_HPP__
+#define __RING_BUFFER_HPP__
+
+#include "atomic"
+#include "cstddef"
+
+// lock-free single-producer, single-consumer ring buffer, safe to be fed from an interrupt handler;
+// push() may only be called from the producer context and pop() from the consumer context
+
+template <typename T, std::size_t N>
+class RingBuffer
+{
+    static_assert(N != 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    bool push(const T & item);
+    bool pop(T & item);
+    std::size_t size() const;
+
+    bool empty() const
+    { return size() == 0; }
+
+    static constexpr std::size_t capacity()
+    { return N; }
+
+    // not thread-safe, both sides must be idle
+    void clear()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    T buffer[N];
+    std::atomic<std::size_t> head {0}; // next slot to write, owned by the producer
+    std::atomic<std::size_t> tail {0}; // next slot to read, owned by the consumer
+};
+
+template <typename T, std::size_t N>
+inline bool RingBuffer<T, N>::push(const T & item)
+{
+    const std::size_t localHead = head.load(std::memory_order_relaxed);
+
+    if (localHead - tail.load(std::memory_order_acquire) == N)
+    {
+        return false; // full
+    }
+
+    buffer[localHead & (N - 1)] = item;
+    head.store(localHead + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T, std::size_t N>
+inline bool RingBuffer<T, N>::pop(T & item)
+{
+    const std::size_t localTail = tail.load(std::memory_order_relaxed);
+
+    if (head.load(std::memory_order_acquire) == localTail)
+    {
+        return false; // empty
+    }
+
+    item = buffer[localTail & (N - 1)];
+    tail.store(localTail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T, std::size_t N>
+inline std::size_t RingBuffer<T, N>::size() const
+{
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+#endif // __RING_BUFFER_HPP__
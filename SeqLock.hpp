@@ -0,0 +1,97 @@
+#ifndef __SEQ_LOCK_HPP__
+#define __SEQ_LOCK_HPP__
+
+#include "atomic"
+#include "cstddef"
+#include "cstdint"
+#include "cstring"
+#include "type_traits"
+
+// single-writer, multiple-reader publication of a trivially copyable value: the writer never waits
+// and readers never block the writer; the value is double-buffered so that a reader only retries if
+// the writer has completed an update in the middle of the read, in particular a high-priority reader
+// that preempts the writer halfway through an update still reads the previous value without spinning
+// (a plain sequence lock would livelock in that scenario on a single-core, priority-based scheduler)
+
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "published type must be trivially copyable");
+
+public:
+    SeqLock()
+    {
+        for (auto & slot : slots)
+        {
+            for (auto & word : slot)
+            {
+                word.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // must not be called concurrently from more than one thread
+    void store(const T & value);
+
+    T load() const;
+
+    // incremented by one on each store(), can be used to detect updates without copying the value
+    uint32_t sequence() const
+    { return seq.load(std::memory_order_acquire); }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    // data is accessed word by word through atomics so that concurrent reads and writes are well-defined
+    std::atomic<uint32_t> slots[2][WORDS];
+    std::atomic<uint32_t> seq {0}; // the slot indexed by seq & 1 holds the latest value
+};
+
+template <typename T>
+inline void SeqLock<T>::store(const T & value)
+{
+    uint32_t words[WORDS] {};
+    std::memcpy(words, &value, sizeof(T));
+
+    const uint32_t next = seq.load(std::memory_order_relaxed) + 1;
+    auto & slot = slots[next & 1];
+
+    // pairs with the acquire fence in load(): a reader that observes any of the words below also
+    // observes that the sequence number has moved past the one it started with, and retries
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i < WORDS; i++)
+    {
+        slot[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    seq.store(next, std::memory_order_release);
+}
+
+template <typename T>
+inline T SeqLock<T>::load() const
+{
+    uint32_t words[WORDS];
+    uint32_t before, after;
+
+    do
+    {
+        before = seq.load(std::memory_order_acquire);
+        const auto & slot = slots[before & 1];
+
+        for (std::size_t i = 0; i < WORDS; i++)
+        {
+            words[i] = slot[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = seq.load(std::memory_order_relaxed);
+    }
+    while (before != after); // the writer might have started overwriting this slot, retry
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+}
+
+#endif // __SEQ_LOCK_HPP__
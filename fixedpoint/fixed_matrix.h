@@ -0,0 +1,104 @@
+#ifndef FIXEDP_MATRIX_H_INCLUDED
+#define FIXEDP_MATRIX_H_INCLUDED
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+#include "fixed_class.h"
+
+namespace fixedpoint {
+
+namespace detail {
+
+// Dot product unrolled at compile time. Each step is a 32x32->64 bit multiply-accumulate,
+// which maps to a single SMLAL instruction on ARMv7-M.
+template <int n, int p>
+struct dot_product
+{
+    static inline long long accumulate(long long acc, const fixed_point<p> *a, const fixed_point<p> *b)
+    {
+        return dot_product<n - 1, p>::accumulate(
+            acc + static_cast<long long>(a->intValue) * b->intValue, a + 1, b + 1);
+    }
+};
+
+template <int p>
+struct dot_product<0, p>
+{
+    static inline long long accumulate(long long acc, const fixed_point<p> *, const fixed_point<p> *)
+    { return acc; }
+};
+
+template <int row, int rows, int cols, int p>
+struct matrix_rows
+{
+    static inline void multiply(const fixed_point<p> *m, const fixed_point<p> *v, fixed_point<p> *out)
+    {
+        out[row].intValue = static_cast<int>(dot_product<cols, p>::accumulate(0, m + (row * cols), v) >> p);
+        matrix_rows<row + 1, rows, cols, p>::multiply(m, v, out);
+    }
+};
+
+template <int rows, int cols, int p>
+struct matrix_rows<rows, rows, cols, p>
+{
+    static inline void multiply(const fixed_point<p> *, const fixed_point<p> *, fixed_point<p> *)
+    {}
+};
+
+template <int row, int rows, int cols, int p>
+struct column_rows
+{
+    static inline void accumulate(const fixed_point<p> *c, fixed_point<p> x, long long *acc)
+    {
+        acc[row] += static_cast<long long>(c[row * cols].intValue) * x.intValue;
+        column_rows<row + 1, rows, cols, p>::accumulate(c, x, acc);
+    }
+};
+
+template <int rows, int cols, int p>
+struct column_rows<rows, rows, cols, p>
+{
+    static inline void accumulate(const fixed_point<p> *, fixed_point<p>, long long *)
+    {}
+};
+
+} // end namespace detail
+
+// out = m * v, with m being a row-major matrix of the given dimensions. The result is bit-exact
+// with calling multiply_accumulate(cols, m + i * cols, v) for each row i, but loops are fully
+// unrolled at compile time. The output must not alias the input vector.
+template <int rows, int cols, int p>
+inline void multiply_matrix_vector(
+    const fixed_point<p> *m,
+    const fixed_point<p> *v,
+    fixed_point<p> *out)
+{
+    detail::matrix_rows<0, rows, cols, p>::multiply(m, v, out);
+}
+
+// acc[i] += m[i * cols + column] * x for each row i. This allows computing a matrix-vector product
+// one input element at a time, as soon as it becomes available. Since accumulation is performed
+// on 64-bit integers, the final result does not depend on the order in which columns are fed.
+template <int rows, int cols, int p>
+inline void accumulate_matrix_column(
+    const fixed_point<p> *m,
+    int column,
+    fixed_point<p> x,
+    long long *acc)
+{
+    detail::column_rows<0, rows, cols, p>::accumulate(m + column, x, acc);
+}
+
+// Converts the accumulators back to fixed point, same rounding as in multiply_accumulate().
+template <int n, int p>
+inline void accumulators_to_fixed(const long long *acc, fixed_point<p> *out)
+{
+    for (int i = 0; i < n; ++i)
+        out[i].intValue = static_cast<int>(acc[i] >> p);
+}
+
+} // end namespace fixedpoint
+
+#endif
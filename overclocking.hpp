@@ -2,8 +2,54 @@
 #define __OVERCLOCKING_HPP__
 
 #include "mbed.h"
+#include "PllSolver.hpp"
 
-void setSystemFrequency(int clkDiv, int M, int N)
+// callbacks run right after the CPU clock has changed, in the context of the caller of setSystemFrequency();
+// peripherals that derive their timing from PCLK (e.g. UART baud rates, CAN bit timing) must be reconfigured
+// by the application, possibly from one of these listeners
+using system_frequency_listener = mbed::Callback<void(uint32_t)>;
+
+constexpr int MAX_SYSTEM_FREQUENCY_LISTENERS = 4;
+
+inline system_frequency_listener * getSystemFrequencyListeners()
+{
+    static system_frequency_listener listeners[MAX_SYSTEM_FREQUENCY_LISTENERS];
+    return listeners;
+}
+
+inline bool addSystemFrequencyListener(system_frequency_listener listener)
+{
+    system_frequency_listener * listeners = getSystemFrequencyListeners();
+
+    for (int i = 0; i < MAX_SYSTEM_FREQUENCY_LISTENERS; i++)
+    {
+        if (!listeners[i])
+        {
+            listeners[i] = listener;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// keeps the timers derived from the CPU clock running at their nominal rate
+inline void updateTimingConstants()
+{
+    // us ticker (TIMER3), otherwise all timestamps and timeouts would be off by the overclocking factor
+    static const uint32_t pclkDividers[] = {4, 1, 2, 8};
+    const uint32_t pclk = SystemCoreClock / pclkDividers[(LPC_SC->PCLKSEL1 >> 14) & 0x03];
+    LPC_TIM3->PR = pclk / 1000000 - 1;
+
+#if MBED_CONF_RTOS_PRESENT
+    // kernel tick (SysTick), fixed to 1 kHz in mbed OS
+    SysTick->LOAD = SystemCoreClock / 1000 - 1;
+#endif
+}
+
+// returns false (and leaves the clock untouched) on invalid PLL0 parameters, including those that exceed
+// pll_config::MAX_CCLK_HZ; flash wait states are adjusted to the new CPU clock
+inline bool setSystemFrequency(int clkDiv, int M, int N)
 {
     // see M/N values at https://os.mbed.com/users/no2chem/notebook/mbed-clock-control--benchmarks/
     // this code was mostly borrowed from https://os.mbed.com/forum/mbed/topic/229/?page=2#comment-8566
@@ -21,6 +67,25 @@ void setSystemFrequency(int clkDiv, int M, int N)
     // Fcco = (2 * M * Fin) / N;
     // CCLK = Fcco / CCLKDIV; // this should yield 96 MHz
 
+    const pll_config config {clkDiv, M, N};
+
+    if (!config.isValid())
+    {
+        return false;
+    }
+
+    const uint32_t flashAccessTime = pll_config::flashAccessTime(config.cclk()) << 12;
+
+    core_util_critical_section_enter(); // timers are inconsistent until the end of this function
+
+    const bool faster = config.cclk() > SystemCoreClock;
+
+    if (faster)
+    {
+        // more flash wait states before speeding up, the remaining bits of FLASHCFG must be preserved
+        LPC_SC->FLASHCFG = (LPC_SC->FLASHCFG & ~0xF000UL) | flashAccessTime;
+    }
+
     LPC_SC->PLL0CON   = 0x00; // PLL0 Disable
     LPC_SC->PLL0FEED  = 0xAA;
     LPC_SC->PLL0FEED  = 0x55;
@@ -28,6 +93,7 @@ void setSystemFrequency(int clkDiv, int M, int N)
     LPC_SC->CCLKCFG   = clkDiv - 1; // Select Clock Divisor
     LPC_SC->PLL0CFG   = (((unsigned int)N - 1) << 16) | (M - 1); // configure PLL0
     LPC_SC->PLL0FEED  = 0xAA;
+    LPC_SC->PLL0FEED  = 0x55;
 
     LPC_SC->PLL0CON   = 0x01; // PLL0 Enable
     LPC_SC->PLL0FEED  = 0xAA;
@@ -48,6 +114,36 @@ void setSystemFrequency(int clkDiv, int M, int N)
     //                              (((LPC_SC->PLL0STAT >> 16) & 0xFF) + 1) *
     //                              ((LPC_SC->PLL0STAT & 0x7FFF) + 1) /
     //                              ((LPC_SC->CCLKCFG & 0xFF) + 1));
+
+    if (!faster)
+    {
+        // fewer flash wait states once slowed down
+        LPC_SC->FLASHCFG = (LPC_SC->FLASHCFG & ~0xF000UL) | flashAccessTime;
+    }
+
+    updateTimingConstants();
+
+    core_util_critical_section_exit();
+
+    system_frequency_listener * listeners = getSystemFrequencyListeners();
+
+    for (int i = 0; i < MAX_SYSTEM_FREQUENCY_LISTENERS; i++)
+    {
+        if (listeners[i])
+        {
+            listeners[i](SystemCoreClock);
+        }
+    }
+
+    return true;
+}
+
+// picks the closest attainable frequency up to pll_config::MAX_CCLK_HZ, e.g. setSystemFrequency(128000000)
+// yields (3, 16, 1); check SystemCoreClock afterwards for the actual value
+inline bool setSystemFrequency(uint32_t targetHz)
+{
+    pll_config config {};
+    return pll_config::solve(targetHz, config) && setSystemFrequency(config.clkDiv, config.M, config.N);
 }
 
 #endif // __OVERCLOCKING_HPP__
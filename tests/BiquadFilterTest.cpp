@@ -0,0 +1,217 @@
+// host test of BiquadFilter against double-precision references: the same quantized coefficients run in
+// floating point (arithmetic error of the engine), and the ideal designs computed independently (which also
+// includes the effect of quantizing coefficients to Q29, noticeable at very low cutoff frequencies); plus
+// exact DC gain and saturation of the 16-bit output on overshoot
+
+#include "cmath"
+#include "cstdint"
+#include "cstdio"
+#include "vector"
+
+#include "BiquadFilter.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    constexpr double FS = 1.0 / 128.5e-6; // nominal frame set rate
+    constexpr double SCALE = 1 << FIXED_PRECISION; // full scale in fixed_t
+    constexpr int SAMPLES = 40000; // about five seconds
+
+    struct reference_section
+    {
+        double b0, b1, b2, a1, a2;
+        double x1, x2, y1, y2;
+
+        double process(double x)
+        {
+            const double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+            x2 = x1; x1 = x;
+            y2 = y1; y1 = y;
+            return y;
+        }
+    };
+
+    // RBJ audio EQ cookbook
+    reference_section lowPass(double f, double q)
+    {
+        const double w0 = 2.0 * M_PI * f / FS;
+        const double alpha = std::sin(w0) / (2.0 * q);
+        const double a0 = 1.0 + alpha;
+        const double b = (1.0 - std::cos(w0)) / 2.0;
+        return {b / a0, 2.0 * b / a0, b / a0, -2.0 * std::cos(w0) / a0, (1.0 - alpha) / a0, 0, 0, 0, 0};
+    }
+
+    reference_section notch(double f, double q)
+    {
+        const double w0 = 2.0 * M_PI * f / FS;
+        const double alpha = std::sin(w0) / (2.0 * q);
+        const double a0 = 1.0 + alpha;
+        const double a1 = -2.0 * std::cos(w0) / a0;
+        return {1.0 / a0, a1, 1.0 / a0, a1, (1.0 - alpha) / a0, 0, 0, 0, 0};
+    }
+
+    reference_section firstOrder(double factor)
+    {
+        return {factor, 0.0, 0.0, factor - 1.0, 0.0, 0, 0, 0, 0};
+    }
+
+    struct test_case
+    {
+        const char * name;
+        BiquadFilter::coefficients coeffs;
+        std::vector<reference_section> reference;
+        double tolerance; // max error relative to full scale, against the ideal design
+    };
+
+    // the engine's own coefficients, in floating point
+    std::vector<reference_section> quantized(const BiquadFilter::coefficients & coeffs)
+    {
+        const double scale = 1L << BiquadFilter::COEFF_PRECISION;
+        std::vector<reference_section> sections;
+
+        for (int i = 0; i < coeffs.count; i++)
+        {
+            const auto & c = coeffs.sections[i];
+            sections.push_back({c.b0 / scale, c.b1 / scale, c.b2 / scale, c.a1 / scale, c.a2 / scale, 0, 0, 0, 0});
+        }
+
+        return sections;
+    }
+
+    constexpr double ARITHMETIC_TOLERANCE = 1e-6; // a few hundredths of the LSB of the 16-bit output
+
+    int failures = 0;
+
+    // max error over a step followed by a sine, both below full scale
+    void run(test_case & t)
+    {
+        BiquadFilter filter;
+        filter.reset(0);
+        std::vector<reference_section> exact = quantized(t.coeffs);
+        double maxError = 0.0;
+        double maxArithmeticError = 0.0;
+
+        for (int n = 0; n < SAMPLES; n++)
+        {
+            const double input = n < SAMPLES / 2 ? 0.5 : 0.3 * std::sin(2.0 * M_PI * 20.0 * n / FS);
+            const int32_t x = static_cast<int32_t>(std::lround(input * SCALE));
+
+            double expected = x / SCALE;
+
+            double same = expected;
+
+            for (auto & section : t.reference)
+            {
+                expected = section.process(expected);
+            }
+
+            for (auto & section : exact)
+            {
+                same = section.process(same);
+            }
+
+            const double actual = filter.process(t.coeffs, x) / SCALE;
+            maxError = std::fmax(maxError, std::fabs(actual - expected));
+            maxArithmeticError = std::fmax(maxArithmeticError, std::fabs(actual - same));
+        }
+
+        const bool ok = maxError <= t.tolerance && maxArithmeticError <= ARITHMETIC_TOLERANCE;
+        std::printf("%-36s max error %.2e (tolerance %.0e), arithmetic %.2e %s\n",
+                    t.name, maxError, t.tolerance, maxArithmeticError, ok ? "" : "FAILED");
+        failures += ok ? 0 : 1;
+    }
+
+    void check(bool condition, const char * what)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    std::vector<test_case> cases;
+    const double cutOffs[] = {1.0, 10.0, 100.0, 1000.0};
+    char names[12][40];
+    int count = 0;
+
+    for (const double f : cutOffs)
+    {
+        // Q29 coefficients of second-order sections are coarse relative to w0^2 at very low cutoffs
+        const double tolerance = f < 5.0 ? 1e-3 : 1e-5;
+
+        const double period = 1.0 / FS;
+        const double factor = period / (period + 1.0 / (2.0 * M_PI * f));
+
+        test_case first {names[count], {}, {firstOrder(factor)}, 1e-6};
+        std::snprintf(names[count++], sizeof(names[0]), "first order, %g Hz", f);
+        first.coeffs.addFirstOrder(factor);
+        cases.push_back(first);
+
+        test_case second {names[count], {}, {lowPass(f, BiquadFilter::BUTTERWORTH_2_Q)}, tolerance};
+        std::snprintf(names[count++], sizeof(names[0]), "Butterworth 2, %g Hz", f);
+        second.coeffs.addLowPass(f, FS, BiquadFilter::BUTTERWORTH_2_Q);
+        cases.push_back(second);
+
+        test_case fourth {names[count], {}, {lowPass(f, BiquadFilter::BUTTERWORTH_4_Q1), lowPass(f, BiquadFilter::BUTTERWORTH_4_Q2)}, tolerance};
+        std::snprintf(names[count++], sizeof(names[0]), "Butterworth 4, %g Hz", f);
+        fourth.coeffs.addLowPass(f, FS, BiquadFilter::BUTTERWORTH_4_Q1);
+        fourth.coeffs.addLowPass(f, FS, BiquadFilter::BUTTERWORTH_4_Q2);
+        cases.push_back(fourth);
+    }
+
+    test_case notched {"Butterworth 2, 100 Hz + notch 50 Hz", {}, {lowPass(100.0, BiquadFilter::BUTTERWORTH_2_Q), notch(50.0, 5.0)}, 1e-5};
+    notched.coeffs.addLowPass(100.0, FS, BiquadFilter::BUTTERWORTH_2_Q);
+    notched.coeffs.addNotch(50.0, FS, 5.0);
+    cases.push_back(notched);
+
+    for (auto & t : cases)
+    {
+        run(t);
+    }
+
+    // exact DC gain: a constant input eventually comes out unchanged, bit by bit
+    for (auto & t : cases)
+    {
+        BiquadFilter filter;
+        filter.reset(0);
+        const int32_t x = 123456789;
+        int32_t y = 0;
+
+        for (int n = 0; n < 20 * SAMPLES; n++)
+        {
+            y = filter.process(t.coeffs, x);
+        }
+
+        check(y == x, t.name);
+    }
+
+    // a full-scale step overshoots beyond the range of the 16-bit output, which must saturate
+    BiquadFilter::coefficients fourth {};
+    fourth.addLowPass(100.0, FS, BiquadFilter::BUTTERWORTH_4_Q1);
+    fourth.addLowPass(100.0, FS, BiquadFilter::BUTTERWORTH_4_Q2);
+
+    BiquadFilter filter;
+    filter.reset(0);
+    const fixed_t step = jr3ToFixedPoint(0x8000); // most negative reading, i.e. +1.0 after negation
+    int32_t peak = 0;
+    bool wrapped = false;
+
+    for (int n = 0; n < SAMPLES; n++)
+    {
+        fixed_t y;
+        y.intValue = filter.process(fourth, step.intValue);
+        peak = y.intValue > peak ? y.intValue : peak;
+        wrapped |= static_cast<int16_t>(jr3FromFixedPoint(y)) > 0; // the sign must not flip
+    }
+
+    std::printf("full-scale step: peak %d (full scale %d)\n", peak, 1 << FIXED_PRECISION);
+    check(peak > (1 << FIXED_PRECISION), "overshoot beyond full scale");
+    check(!wrapped, "saturated 16-bit output");
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
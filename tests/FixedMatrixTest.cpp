@@ -0,0 +1,90 @@
+// host test and benchmark of multiply_matrix_vector(): bit-exact results against the runtime-count
+// multiply_accumulate() loop it replaces in the sensor thread, and the time taken by either of them
+
+#include "chrono"
+#include "cstdint"
+#include "cstdio"
+#include "random"
+
+#include "utils.hpp"
+
+namespace
+{
+    constexpr int CASES = 200000;
+    constexpr int ITERATIONS = 2000000;
+
+    // same as the code path replaced by multiply_matrix_vector<6, 6>()
+    __attribute__((noinline)) void referenceDecoupling(const fixed_t * m, const fixed_t * v, fixed_t * out)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            out[i] = fixedpoint::multiply_accumulate(6, m + (i * 6), v);
+        }
+    }
+
+    __attribute__((noinline)) void unrolledDecoupling(const fixed_t * m, const fixed_t * v, fixed_t * out)
+    {
+        fixedpoint::multiply_matrix_vector<6, 6>(m, v, out);
+    }
+
+    template <typename F>
+    double benchmark(F f, const fixed_t * m, fixed_t * v, fixed_t * out)
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            v[i % 6].intValue ^= i; // keep the compiler from hoisting the computation
+            f(m, v, out);
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int32_t> any(INT32_MIN, INT32_MAX);
+    std::uniform_int_distribution<uint32_t> raw(0, 0xFFFF);
+
+    fixed_t m[36], v[6], expected[6], actual[6];
+    int mismatches = 0;
+
+    for (int n = 0; n < CASES; n++)
+    {
+        // calibration matrices span the whole Q30 range, inputs are actual 16-bit sensor readings
+        for (auto & c : m)
+        {
+            c.intValue = any(rng) >> (n % 4); // also exercise smaller magnitudes
+        }
+
+        for (auto & x : v)
+        {
+            x = jr3ToFixedPoint(raw(rng));
+        }
+
+        referenceDecoupling(m, v, expected);
+        unrolledDecoupling(m, v, actual);
+
+        for (int i = 0; i < 6; i++)
+        {
+            if (expected[i].intValue != actual[i].intValue)
+            {
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    std::printf("%d of %d cases differ\n", mismatches, CASES);
+
+    const double reference = benchmark(referenceDecoupling, m, v, expected);
+    const double unrolled = benchmark(unrolledDecoupling, m, v, actual);
+
+    // host timings only give a rough idea, see STAGE_DECOUPLING in getPipelineStats() for the target
+    std::printf("multiply_accumulate() loop: %.1f ns, multiply_matrix_vector(): %.1f ns\n", reference, unrolled);
+
+    return mismatches == 0 ? 0 : 1;
+}
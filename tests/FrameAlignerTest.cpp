@@ -0,0 +1,204 @@
+// host test of Jr3FrameAligner: a synthetic bitstream of back-to-back frames (channel addresses cycling
+// through 0..7, random payloads) is split into 16-bit words at every possible bit offset; the aligner must
+// lock within a few channel cycles, recover every frame from then on, and resynchronize after bit slips
+
+#include "cstdint"
+#include "cstdio"
+#include "random"
+#include "vector"
+
+#include "Jr3FrameAligner.hpp"
+
+namespace
+{
+    constexpr int FRAMES = 2000;
+    constexpr int MAX_LOCK_FRAMES = 3 * 8; // frames sent before the first one is recovered
+    constexpr int MAX_BAD_FRAMES = 1; // garbage frames delivered after a bit slip, until the lock is lost
+    constexpr int MAX_LOST_FRAMES = 3 * 8; // frames not recovered because of a bit slip
+
+    int failures = 0;
+
+    void check(bool condition, const char * what, int offset)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s (offset %d)\n", what, offset);
+            failures++;
+        }
+    }
+
+    std::vector<bool> serialize(const std::vector<uint32_t> & frames)
+    {
+        std::vector<bool> bits;
+
+        for (const auto frame : frames)
+        {
+            for (int i = Jr3FrameAligner::FRAME_SIZE - 1; i >= 0; i--)
+            {
+                bits.push_back(frame & (1UL << i));
+            }
+        }
+
+        return bits;
+    }
+
+    struct result
+    {
+        int firstIndex; // index of the first recovered frame in the sent sequence, -1 if none
+        int recovered; // frames matching the sent sequence
+        int bad; // frames that do not
+    };
+
+    // feeds whole words (MSB first), a trailing partial word is dropped; recovered frames are looked up in
+    // the sent sequence by position, starting from the first one that matches
+    result align(Jr3FrameAligner & aligner, const std::vector<bool> & bits, const std::vector<uint32_t> & sent)
+    {
+        result r {-1, 0, 0};
+        int next = 0;
+
+        for (std::size_t i = 0; i + Jr3FrameAligner::WORD_SIZE <= bits.size(); i += Jr3FrameAligner::WORD_SIZE)
+        {
+            uint16_t word = 0;
+            uint32_t frame;
+
+            for (unsigned int j = 0; j < Jr3FrameAligner::WORD_SIZE; j++)
+            {
+                word = (word << 1) | (bits[i + j] ? 1 : 0);
+            }
+
+            if (!aligner.push(word, frame))
+            {
+                continue;
+            }
+
+            // frames may be lost, never reordered; look ahead a bit to skip them
+            int found = -1;
+
+            for (int k = next; k < static_cast<int>(sent.size()) && k < next + 4 * MAX_LOST_FRAMES; k++)
+            {
+                if (sent[k] == frame)
+                {
+                    found = k;
+                    break;
+                }
+            }
+
+            if (found == -1)
+            {
+                r.bad++;
+                continue;
+            }
+
+            if (r.firstIndex == -1)
+            {
+                r.firstIndex = found;
+            }
+
+            r.recovered++;
+            next = found + 1;
+        }
+
+        return r;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(4321);
+    std::uniform_int_distribution<uint32_t> payload(0, 0xFFFF);
+    std::uniform_int_distribution<int> garbage(0, 1);
+
+    std::vector<uint32_t> sent;
+
+    for (int i = 0; i < FRAMES; i++)
+    {
+        sent.push_back((static_cast<uint32_t>(i % 8) << 16) | payload(rng));
+    }
+
+    const std::vector<bool> stream = serialize(sent);
+
+    // any bit offset between the start of the capture and the first frame boundary: leading garbage bits
+    // from a partially received frame, or the first bits of the stream missing
+    for (int offset = -static_cast<int>(Jr3FrameAligner::FRAME_SIZE) + 1; offset < static_cast<int>(Jr3FrameAligner::FRAME_SIZE); offset++)
+    {
+        std::vector<bool> bits;
+
+        if (offset >= 0)
+        {
+            for (int i = 0; i < offset; i++)
+            {
+                bits.push_back(garbage(rng));
+            }
+
+            bits.insert(bits.end(), stream.begin(), stream.end());
+        }
+        else
+        {
+            bits.assign(stream.begin() - offset, stream.end());
+        }
+
+        Jr3FrameAligner aligner;
+        const result r = align(aligner, bits, sent);
+        const int expected = FRAMES - r.firstIndex - 1; // the last frame may be incomplete
+
+        check(aligner.isLocked(), "locked", offset);
+        check(r.firstIndex != -1 && r.firstIndex <= MAX_LOCK_FRAMES, "locked within three channel cycles", offset);
+        check(r.bad == 0, "no garbage frames", offset);
+        check(r.recovered >= expected, "every frame recovered once locked", offset);
+        check(aligner.getResynchronizations() == 0, "no resynchronizations on a clean stream", offset);
+    }
+
+    // bit slips in the middle of the stream: one bit lost, one bit inserted, then both of them
+    const int slips[][2] = {{-1, 0}, {+1, 0}, {-1, +1}};
+
+    for (int s = 0; s < 3; s++)
+    {
+        std::vector<bool> bits = stream;
+        int expectedSlips = 0;
+
+        // slips at frame boundaries and in the middle of a frame, at well separated positions
+        for (int k = 0; k < 2; k++)
+        {
+            if (slips[s][k] == 0)
+            {
+                continue;
+            }
+
+            const std::size_t position = (FRAMES / 3) * (k + 1) * Jr3FrameAligner::FRAME_SIZE + k * 7;
+
+            if (slips[s][k] < 0)
+            {
+                bits.erase(bits.begin() + position);
+            }
+            else
+            {
+                bits.insert(bits.begin() + position, !bits[position]);
+            }
+
+            expectedSlips++;
+        }
+
+        Jr3FrameAligner aligner;
+        const result r = align(aligner, bits, sent);
+        const int expected = FRAMES - r.firstIndex - 1 - expectedSlips * MAX_LOST_FRAMES;
+
+        check(aligner.isLocked(), "locked again after bit slips", s);
+        check(static_cast<int>(aligner.getResynchronizations()) == expectedSlips, "one resynchronization per slip", s);
+        check(r.bad <= expectedSlips * MAX_BAD_FRAMES, "few garbage frames after bit slips", s);
+        check(r.recovered >= expected, "frames recovered after bit slips", s);
+    }
+
+    // reset drops any buffered bits and the lock
+    {
+        Jr3FrameAligner aligner;
+        align(aligner, stream, sent);
+        aligner.reset();
+        check(!aligner.isLocked(), "unlocked after reset", 0);
+
+        const result r = align(aligner, stream, sent);
+        check(r.firstIndex != -1 && r.firstIndex <= MAX_LOCK_FRAMES && r.bad == 0, "locked again after reset", 0);
+    }
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
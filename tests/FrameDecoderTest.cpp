@@ -0,0 +1,205 @@
+// host test of Jr3FrameDecoder: frames assembled from sampled waveforms and from edge events in the order
+// the interrupt handler reports them, start pulse detection (including false start pulses and short pulses
+// coalesced within a single interrupt) and the edges the decoder asks for in each state
+
+#include "cstdint"
+#include "cstdio"
+#include "random"
+#include "vector"
+
+#include "Jr3FrameDecoder.hpp"
+
+namespace
+{
+    using pins = Jr3FrameDecoder::pin_state;
+
+    constexpr int FRAMES = 1000;
+
+    int failures = 0;
+
+    void check(bool condition, const char * what)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    // interval between frames, start pulse, then 20 bits sampled on rising clock edges (MSB first)
+    void encodeFrame(uint32_t frame, int oversampling, std::vector<pins> & out)
+    {
+        auto emit = [&](pins p)
+        {
+            out.insert(out.end(), oversampling, p);
+        };
+
+        emit(Jr3FrameDecoder::DATA_HIGH_CLOCK_HIGH);
+        emit(Jr3FrameDecoder::DATA_LOW_CLOCK_HIGH);
+        emit(Jr3FrameDecoder::DATA_HIGH_CLOCK_HIGH);
+
+        for (int i = 19; i >= 0; i--)
+        {
+            const bool bit = frame & (1UL << i);
+            emit(bit ? Jr3FrameDecoder::DATA_HIGH_CLOCK_LOW : Jr3FrameDecoder::DATA_LOW_CLOCK_LOW);
+            emit(bit ? Jr3FrameDecoder::DATA_HIGH_CLOCK_HIGH : Jr3FrameDecoder::DATA_LOW_CLOCK_HIGH);
+        }
+    }
+
+    std::vector<uint32_t> decode(Jr3FrameDecoder & decoder, const std::vector<pins> & waveform)
+    {
+        std::vector<uint32_t> frames;
+        uint32_t frame;
+
+        for (const auto p : waveform)
+        {
+            if (decoder.push(p, frame))
+            {
+                frames.push_back(frame);
+            }
+        }
+
+        return frames;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<uint32_t> any(0, 0xFFFFF);
+
+    std::vector<uint32_t> sent;
+
+    for (int i = 0; i < FRAMES; i++)
+    {
+        sent.push_back(any(rng));
+    }
+
+    sent[0] = 0x00000; // extreme bit patterns
+    sent[1] = 0xFFFFF;
+    sent[2] = 0xAAAAA;
+
+    // sampled waveforms, the level of each signal held for one or several samples
+    for (int oversampling = 1; oversampling <= 4; oversampling++)
+    {
+        std::vector<pins> waveform;
+
+        for (const auto frame : sent)
+        {
+            encodeFrame(frame, oversampling, waveform);
+        }
+
+        Jr3FrameDecoder decoder;
+        check(decode(decoder, waveform) == sent, "frames decoded from a sampled waveform");
+        check(decoder.getFalseStartPulses() == 0, "no false start pulses on a clean waveform");
+    }
+
+    // edge events, as reported by the interrupt handler: the level of the other signal is sampled at once
+    {
+        Jr3FrameDecoder decoder;
+        std::vector<uint32_t> frames;
+        uint32_t frame;
+
+        check(!decoder.wantsClockEdges() && decoder.wantsDataEdges(), "only data edges while idle");
+
+        for (const auto value : sent)
+        {
+            // a start pulse shorter than the interrupt latency: both data edges handled in one go
+            decoder.push(Jr3FrameDecoder::DATA_FALLING, true, frame);
+            decoder.push(Jr3FrameDecoder::DATA_RISING, true, frame);
+
+            if (!decoder.wantsClockEdges() || decoder.wantsDataEdges())
+            {
+                check(false, "only clock edges while reading bits");
+            }
+
+            for (int i = 19; i >= 0; i--)
+            {
+                if (decoder.push(Jr3FrameDecoder::CLOCK_RISING, value & (1UL << i), frame))
+                {
+                    check(i == 0, "frame completed on its last bit");
+                    frames.push_back(frame);
+                }
+            }
+
+            if (decoder.wantsClockEdges() || !decoder.wantsDataEdges())
+            {
+                check(false, "back to idle after the last bit");
+            }
+        }
+
+        check(frames == sent, "frames decoded from edge events");
+    }
+
+    // false start pulses: data rises while the clock is low, or the clock rises in the middle of the pulse
+    {
+        Jr3FrameDecoder decoder;
+        std::vector<pins> waveform;
+
+        waveform.push_back(Jr3FrameDecoder::DATA_HIGH_CLOCK_HIGH);
+        waveform.push_back(Jr3FrameDecoder::DATA_LOW_CLOCK_HIGH);
+        waveform.push_back(Jr3FrameDecoder::DATA_LOW_CLOCK_LOW);
+        waveform.push_back(Jr3FrameDecoder::DATA_HIGH_CLOCK_LOW);
+        encodeFrame(sent[3], 1, waveform);
+
+        waveform.push_back(Jr3FrameDecoder::DATA_HIGH_CLOCK_HIGH);
+        waveform.push_back(Jr3FrameDecoder::DATA_LOW_CLOCK_HIGH);
+        waveform.push_back(Jr3FrameDecoder::DATA_LOW_CLOCK_LOW);
+        waveform.push_back(Jr3FrameDecoder::DATA_LOW_CLOCK_HIGH);
+        encodeFrame(sent[4], 1, waveform);
+
+        const std::vector<uint32_t> frames = decode(decoder, waveform);
+        check(frames.size() == 2 && frames[0] == sent[3] && frames[1] == sent[4], "frames after false start pulses");
+        check(decoder.getFalseStartPulses() == 2, "false start pulses counted");
+    }
+
+    // data edges while the clock is low are not start pulses, nor are they counted as false ones
+    {
+        Jr3FrameDecoder decoder;
+        uint32_t frame;
+
+        decoder.push(Jr3FrameDecoder::DATA_FALLING, false, frame);
+        decoder.push(Jr3FrameDecoder::DATA_RISING, false, frame);
+        check(!decoder.wantsClockEdges() && decoder.getFalseStartPulses() == 0, "data edges with the clock low ignored");
+    }
+
+    // joining in the middle of a frame: the partial frame is dropped, the following ones are decoded
+    {
+        Jr3FrameDecoder decoder;
+        std::vector<pins> waveform;
+
+        for (int i = 0; i < 10; i++)
+        {
+            encodeFrame(sent[i], 1, waveform);
+        }
+
+        waveform.erase(waveform.begin(), waveform.begin() + 17); // start pulse and a few bits of the first frame
+
+        const std::vector<uint32_t> frames = decode(decoder, waveform);
+        check(frames == std::vector<uint32_t>(sent.begin() + 1, sent.begin() + 10), "frames after joining mid-frame");
+    }
+
+    // reset while reading bits
+    {
+        Jr3FrameDecoder decoder;
+        std::vector<pins> waveform;
+        encodeFrame(sent[5], 1, waveform);
+
+        for (int i = 0; i < 20; i++)
+        {
+            uint32_t frame;
+            decoder.push(waveform[i], frame);
+        }
+
+        decoder.reset();
+        check(!decoder.wantsClockEdges() && decoder.wantsDataEdges(), "idle after reset");
+
+        waveform.clear();
+        encodeFrame(sent[6], 1, waveform);
+        const std::vector<uint32_t> frames = decode(decoder, waveform);
+        check(frames.size() == 1 && frames[0] == sent[6], "frame decoded after reset");
+    }
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// host test and benchmark of the incremental decoupling performed by the sensor thread: feeding one
+// column at a time with accumulate_matrix_column() must give the same bits as multiply_matrix_vector()
+// in any order; the work left after the last axis frame (post-frame latency) is timed for both approaches,
+// but note that a desktop CPU runs the 36 multiply-accumulates of the burst in a handful of vector
+// instructions, hence only the cycle counts on target (STAGE_DECOUPLING) are meaningful for comparison
+
+#include "algorithm"
+#include "chrono"
+#include "cstdint"
+#include "cstdio"
+#include "random"
+#include "vector"
+
+#include "utils.hpp"
+
+namespace
+{
+    constexpr int CASES = 200000;
+    constexpr int BATCHES = 20000;
+    constexpr int BATCH_SIZE = 64; // calls per timed batch, amortizes the cost of reading the clock
+
+    // all work done after the last frame of a frame set, with and without incremental decoupling
+    __attribute__((noinline)) void burstDecoupling(const fixed_t * m, const fixed_t * v, long long *, fixed_t * out)
+    {
+        fixedpoint::multiply_matrix_vector<6, 6>(m, v, out);
+    }
+
+    __attribute__((noinline)) void lastColumnDecoupling(const fixed_t * m, const fixed_t * v, long long * acc, fixed_t * out)
+    {
+        fixedpoint::accumulate_matrix_column<6, 6>(m, 5, v[5], acc);
+        fixedpoint::accumulators_to_fixed<6>(acc, out);
+    }
+
+    // per call, over batches
+    struct latency
+    {
+        double median;
+        double p99;
+        double worst; // includes preemptions by the host OS
+    };
+
+    template <typename F>
+    latency benchmark(F f, const fixed_t * m, fixed_t * v, fixed_t * out)
+    {
+        long long acc[6] {};
+        std::vector<double> samples;
+        samples.reserve(BATCHES);
+
+        for (int b = 0; b < BATCHES; b++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < BATCH_SIZE; i++)
+            {
+                v[5].intValue ^= i; // keep the compiler from hoisting the computation
+                f(m, v, acc, out);
+            }
+
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / BATCH_SIZE);
+        }
+
+        std::sort(samples.begin(), samples.end());
+        return {samples[BATCHES / 2], samples[(BATCHES * 99) / 100], samples.back()};
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(54321);
+    std::uniform_int_distribution<int32_t> any(INT32_MIN, INT32_MAX);
+    std::uniform_int_distribution<uint32_t> raw(0, 0xFFFF);
+
+    fixed_t m[36], v[6], expected[6], inOrder[6], shuffled[6];
+    int order[6] = {0, 1, 2, 3, 4, 5};
+    int mismatches = 0;
+
+    for (int n = 0; n < CASES; n++)
+    {
+        for (auto & c : m)
+        {
+            c.intValue = any(rng) >> (n % 4);
+        }
+
+        for (auto & x : v)
+        {
+            x = jr3ToFixedPoint(raw(rng));
+        }
+
+        fixedpoint::multiply_matrix_vector<6, 6>(m, v, expected);
+
+        // axis frames arrive in order, as in the sensor thread
+        long long acc[6] {};
+
+        for (int column = 0; column < 6; column++)
+        {
+            fixedpoint::accumulate_matrix_column<6, 6>(m, column, v[column], acc);
+        }
+
+        fixedpoint::accumulators_to_fixed<6>(acc, inOrder);
+
+        // the result does not depend on the order of the columns either
+        std::shuffle(order, order + 6, rng);
+        long long shuffledAcc[6] {};
+
+        for (const int column : order)
+        {
+            fixedpoint::accumulate_matrix_column<6, 6>(m, column, v[column], shuffledAcc);
+        }
+
+        fixedpoint::accumulators_to_fixed<6>(shuffledAcc, shuffled);
+
+        for (int i = 0; i < 6; i++)
+        {
+            if (expected[i].intValue != inOrder[i].intValue || expected[i].intValue != shuffled[i].intValue)
+            {
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    std::printf("%d of %d cases differ\n", mismatches, CASES);
+
+    const latency burst = benchmark(burstDecoupling, m, v, expected);
+    const latency incremental = benchmark(lastColumnDecoupling, m, v, inOrder);
+
+    std::printf("post-frame latency [ns], median/p99/max: burst %.1f/%.1f/%.1f, incremental %.1f/%.1f/%.1f\n",
+                burst.median, burst.p99, burst.worst, incremental.median, incremental.p99, incremental.worst);
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+// host benchmark of the resampling performed by Jr3Controller::acquireInterpolated(): a signal is sampled at
+// the sensor rate (integer us ticker timestamps) and read at a 1 ms async period; the output is compared
+// against the true value at (instant - delay), with and without interpolation, then the cost is timed
+
+#include "chrono"
+#include "cmath"
+#include "cstdint"
+#include "cstdio"
+
+#include "utils.hpp"
+
+namespace
+{
+    constexpr double SENSOR_PERIOD_US = 128.5;
+    constexpr uint32_t ASYNC_PERIOD_US = 1000;
+    constexpr uint32_t DELAY_US = 129; // one sensor period, rounded as in doAsyncWork()
+    constexpr int TICKS = 100000;
+    constexpr int ITERATIONS = 10000000;
+    constexpr double AMPLITUDE = 0.4; // relative to full scale
+
+    // a 20 Hz force plus a 100 Hz vibration
+    double signal(double us)
+    {
+        const double t = us * 1e-6;
+        return AMPLITUDE * (0.8 * std::sin(2.0 * M_PI * 20.0 * t) + 0.2 * std::sin(2.0 * M_PI * 100.0 * t));
+    }
+
+    fixed_t sampleAt(double us)
+    {
+        fixed_t f;
+        f.intValue = static_cast<int32_t>(std::lround(signal(us) * (1 << FIXED_PRECISION)));
+        return f;
+    }
+}
+
+int main()
+{
+    double maxInterpolated = 0.0;
+    double maxLatest = 0.0;
+
+    for (int tick = 1; tick <= TICKS; tick++)
+    {
+        const uint32_t instant = tick * ASYNC_PERIOD_US + 7 * (tick % 3); // some wake-up jitter
+
+        // the two latest samples published by the sensor thread at that instant
+        const long index = static_cast<long>(std::floor(instant / SENSOR_PERIOD_US));
+        const double t1 = index * SENSOR_PERIOD_US;
+        const double t0 = t1 - SENSOR_PERIOD_US;
+        const uint32_t ts0 = static_cast<uint32_t>(t0); // us ticker resolution
+        const uint32_t ts1 = static_cast<uint32_t>(t1);
+
+        const fixed_t previous[1] = {sampleAt(t0)};
+        const fixed_t current[1] = {sampleAt(t1)};
+        fixed_t out[1];
+
+        interpolateLinear(previous, current, ts1 - ts0, (instant - DELAY_US) - ts0, out, 1);
+
+        const double expected = signal(instant - DELAY_US);
+        const double interpolated = static_cast<double>(out[0].intValue) / (1 << FIXED_PRECISION);
+        const double latest = static_cast<double>(current[0].intValue) / (1 << FIXED_PRECISION);
+
+        maxInterpolated = std::fmax(maxInterpolated, std::fabs(interpolated - expected));
+        maxLatest = std::fmax(maxLatest, std::fabs(latest - expected));
+    }
+
+    std::printf("max error relative to amplitude: interpolated %.2e, latest sample %.2e\n",
+                maxInterpolated / AMPLITUDE, maxLatest / AMPLITUDE);
+
+    // cost of interpolating all six axes
+    fixed_t previous[6], current[6], out[6];
+
+    for (int i = 0; i < 6; i++)
+    {
+        previous[i] = sampleAt(i * 10.0);
+        current[i] = sampleAt(i * 10.0 + SENSOR_PERIOD_US);
+    }
+
+    volatile int32_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        interpolateLinear(previous, current, 128, i & 0x7F, out, 6);
+        sink = sink + out[i % 6].intValue;
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("interpolateLinear(), six axes: %.1f ns per call\n",
+                std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS);
+
+    return maxInterpolated < 1e-3 * AMPLITUDE && maxInterpolated < maxLatest ? 0 : 1;
+}
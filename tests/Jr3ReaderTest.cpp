@@ -0,0 +1,192 @@
+// host test and benchmark of Jr3Reader driven by HostPortAccess: frames decoded from synthetic clock and
+// data waveforms (sampled at several rates, with noise on unrelated port bits), false start pulses, timeouts
+// of tryReadFrame() on an idle link and in the middle of a frame, connection detection, and decoding
+// throughput compared to the nominal frame rate of the sensor
+
+#include "chrono"
+#include "cstdint"
+#include "cstdio"
+#include "random"
+#include "vector"
+
+#include "Jr3HostPortAccess.hpp"
+#include "Jr3Reader.hpp"
+
+namespace
+{
+    using Port = HostPortAccess<>;
+    using Reader = Jr3Reader<Port>;
+
+    constexpr int FRAMES = 1000;
+    constexpr int BENCHMARK_FRAMES = 200000;
+    constexpr uint32_t TIMEOUT_US = 2000;
+    constexpr uint32_t MAX_TIMEOUT_OVERSHOOT_US = 50000; // generous, the host may deschedule us
+    // timeouts may also fall short by one microsecond, since both timestamps are truncated
+    constexpr double NOMINAL_FRAME_RATE = 8 / 128.5e-6; // [frames/s]
+
+    int failures = 0;
+
+    void check(bool condition, const char * what)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    // each signal level is held for 'oversampling' port reads, unrelated port bits are random
+    void encode(uint32_t frame, int oversampling, std::mt19937 & rng, std::vector<uint32_t> & out)
+    {
+        uint32_t samples[Port::SAMPLES_PER_FRAME];
+        const std::size_t n = Port::encodeFrame(frame, samples);
+        std::uniform_int_distribution<uint32_t> noise(0, 0xFFFFFFFF);
+
+        for (std::size_t i = 0; i < n; i++)
+        {
+            for (int k = 0; k < oversampling; k++)
+            {
+                out.push_back(samples[i] | (noise(rng) & ~(Port::CLOCK_MASK | Port::DATA_MASK)));
+            }
+        }
+    }
+
+    uint32_t elapsedUs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(777);
+    std::uniform_int_distribution<uint32_t> any(0, 0xFFFFF);
+
+    std::vector<uint32_t> sent;
+
+    for (int i = 0; i < FRAMES; i++)
+    {
+        sent.push_back(any(rng));
+    }
+
+    sent[0] = 0x00000; // extreme bit patterns
+    sent[1] = 0xFFFFF;
+    sent[2] = 0x55555;
+
+    // readFrame() and tryReadFrame() on clean waveforms, the reader polls once or several times per level
+    for (int oversampling = 1; oversampling <= 4; oversampling++)
+    {
+        std::vector<uint32_t> waveform;
+
+        for (const auto frame : sent)
+        {
+            encode(frame, oversampling, rng, waveform);
+        }
+
+        const Reader reader(waveform.data(), waveform.size());
+        bool ok = true;
+
+        for (int pass = 0; pass < 2; pass++) // the waveform loops
+        {
+            for (const auto frame : sent)
+            {
+                ok &= reader.readFrame() == frame;
+            }
+        }
+
+        for (const auto frame : sent)
+        {
+            ok &= reader.tryReadFrame(TIMEOUT_US) == frame;
+        }
+
+        check(ok, "frames decoded from a clean waveform");
+        check(reader.getFalseStartPulses() == 0, "no false start pulses on a clean waveform");
+    }
+
+    // false start pulses: the clock falls instead of the data line, or in the middle of a start pulse
+    {
+        std::vector<uint32_t> waveform;
+        const uint32_t clock = Port::CLOCK_MASK; // copies, push_back() would odr-use the constants
+        const uint32_t data = Port::DATA_MASK;
+
+        waveform.push_back(clock | data);
+        waveform.push_back(data);
+        encode(sent[3], 1, rng, waveform);
+
+        waveform.push_back(clock | data);
+        waveform.push_back(clock);
+        waveform.push_back(0);
+        encode(sent[4], 1, rng, waveform);
+
+        const Reader reader(waveform.data(), waveform.size(), false);
+        check(reader.readFrame() == sent[3] && reader.readFrame() == sent[4], "frames after false start pulses");
+        check(reader.getFalseStartPulses() == 2, "false start pulses counted");
+    }
+
+    // idle link: both signals stay high, tryReadFrame() gives up in time
+    {
+        const uint32_t idle = Port::CLOCK_MASK | Port::DATA_MASK;
+        const Reader reader(&idle, 1);
+
+        const auto start = std::chrono::steady_clock::now();
+        const uint32_t frame = reader.tryReadFrame(TIMEOUT_US);
+        const uint32_t elapsed = elapsedUs(start);
+
+        check(frame == JR3_INVALID_FRAME, "invalid frame on an idle link");
+        check(elapsed + 1 >= TIMEOUT_US && elapsed < TIMEOUT_US + MAX_TIMEOUT_OVERSHOOT_US, "timeout honored on an idle link");
+        check(!reader.isConnected(), "not connected on an idle link");
+    }
+
+    // the sensor goes away in the middle of a frame: no partial frame is returned
+    {
+        std::vector<uint32_t> waveform;
+        encode(sent[5], 1, rng, waveform);
+        waveform.resize(3 + 2 * 5); // start pulse and five bits
+        waveform.push_back(0); // both signals low from now on
+
+        const Reader reader(waveform.data(), waveform.size(), false);
+
+        const auto start = std::chrono::steady_clock::now();
+        const uint32_t frame = reader.tryReadFrame(TIMEOUT_US);
+        const uint32_t elapsed = elapsedUs(start);
+
+        check(frame == JR3_INVALID_FRAME, "invalid frame if the link drops mid-frame");
+        check(elapsed + 1 >= TIMEOUT_US && elapsed < TIMEOUT_US + MAX_TIMEOUT_OVERSHOOT_US, "timeout honored mid-frame");
+    }
+
+    // connection detection and throughput on an active link
+    {
+        std::vector<uint32_t> waveform;
+
+        for (const auto frame : sent)
+        {
+            encode(frame, 2, rng, waveform);
+        }
+
+        const Reader probe(waveform.data(), waveform.size()); // leaves the waveform at an arbitrary position
+        check(probe.isConnected() && probe.getEdgeRate() > 0, "connected on an active link");
+
+        const Reader reader(waveform.data(), waveform.size());
+
+        const uint64_t initialReads = reader.getPortAccess().getReads();
+        const auto start = std::chrono::steady_clock::now();
+        bool ok = true;
+
+        for (int i = 0; i < BENCHMARK_FRAMES; i++)
+        {
+            ok &= reader.readFrame() == sent[i % FRAMES];
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double reads = static_cast<double>(reader.getPortAccess().getReads() - initialReads) / BENCHMARK_FRAMES;
+        const double rate = BENCHMARK_FRAMES / seconds;
+
+        check(ok, "frames decoded during the benchmark");
+
+        std::printf("readFrame(): %.1f ns per frame, %.1f port reads per frame, %.0f frames/s (%.1fx the nominal rate)\n",
+                    seconds * 1e9 / BENCHMARK_FRAMES, reads, rate, rate / NOMINAL_FRAME_RATE);
+    }
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
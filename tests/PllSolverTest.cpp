@@ -0,0 +1,78 @@
+// host test of the LPC17xx PLL0 parameter solver: exact solutions for the usual frequencies, all results
+// within the user manual limits and the overclocking cap, flash access times for each frequency band
+
+#include "cstdint"
+#include "cstdio"
+
+#include "PllSolver.hpp"
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const char * what, uint32_t targetHz)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s (target %lu Hz)\n", what, static_cast<unsigned long>(targetHz));
+            failures++;
+        }
+    }
+}
+
+int main()
+{
+    // exactly attainable
+    const uint32_t exact[] = {48000000, 96000000, 100000000, 120000000, 128000000};
+
+    for (const auto targetHz : exact)
+    {
+        pll_config config {};
+        check(pll_config::solve(targetHz, config), "solvable", targetHz);
+        check(config.isValid(), "valid", targetHz);
+        check(config.cclk() == targetHz, "exact", targetHz);
+    }
+
+    // the documented overclocking setting
+    pll_config config {};
+    pll_config::solve(128000000, config);
+    check(config.clkDiv == 3 && config.M == 16 && config.N == 1, "(3, 16, 1) for 128 MHz", 128000000);
+
+    // above the cap: clamped, never applied as is
+    const uint32_t tooHigh[] = {150000000, 300000000, 4000000000U};
+
+    for (const auto targetHz : tooHigh)
+    {
+        check(pll_config::solve(targetHz, config), "solvable", targetHz);
+        check(config.isValid() && config.cclk() == pll_config::MAX_CCLK_HZ, "capped", targetHz);
+    }
+
+    // below the lowest attainable frequency
+    check(pll_config::solve(0, config) && config.isValid(), "valid for 0 Hz", 0);
+
+    // sweep: always valid and never farther than the gap between neighbouring divisors
+    for (uint32_t targetHz = 2000000; targetHz <= pll_config::MAX_CCLK_HZ; targetHz += 1000000)
+    {
+        check(pll_config::solve(targetHz, config) && config.isValid(), "valid", targetHz);
+
+        const uint32_t cclk = config.cclk();
+        const uint32_t error = cclk > targetHz ? cclk - targetHz : targetHz - cclk;
+        check(error * 1000ULL <= targetHz, "within 0.1%", targetHz);
+    }
+
+    // invalid raw parameters
+    check(!pll_config {1, 16, 1}.isValid(), "CCLKDIV of one rejected", 0);
+    check(!pll_config {2, 12, 1}.isValid(), "144 MHz rejected", 0);
+    check(!pll_config {3, 11, 1}.isValid(), "Fcco below 275 MHz rejected", 0);
+    check(!pll_config {3, 5, 1}.isValid(), "M below 6 rejected", 0);
+    check(!pll_config {3, 16, 33}.isValid(), "N above 32 rejected", 0);
+
+    // flash access time
+    check(pll_config::flashAccessTime(12000000) == 0, "FLASHTIM at 12 MHz", 12000000);
+    check(pll_config::flashAccessTime(96000000) == 4, "FLASHTIM at 96 MHz", 96000000);
+    check(pll_config::flashAccessTime(100000000) == 4, "FLASHTIM at 100 MHz", 100000000);
+    check(pll_config::flashAccessTime(128000000) == 5, "FLASHTIM at 128 MHz", 128000000);
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
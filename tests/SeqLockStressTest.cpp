@@ -0,0 +1,100 @@
+// host stress test of SeqLock: one writer publishes snapshots whose words all hold the same counter,
+// several readers check that every snapshot they get is consistent (no torn reads) and that counters
+// never go backwards
+
+#include "atomic"
+#include "chrono"
+#include "cstdint"
+#include "cstdio"
+#include "thread"
+#include "vector"
+
+#include "SeqLock.hpp"
+
+namespace
+{
+    struct snapshot
+    {
+        uint32_t words[16]; // several cache lines worth of data on typical hosts
+    };
+
+    constexpr int READERS = 3;
+    constexpr auto DURATION = std::chrono::seconds(2);
+}
+
+int main()
+{
+    SeqLock<snapshot> lock;
+    std::atomic<bool> done {false};
+    std::atomic<uint64_t> torn {0};
+    std::atomic<uint64_t> reordered {0};
+    std::atomic<uint64_t> reads {0};
+
+    std::vector<std::thread> readers;
+
+    for (int r = 0; r < READERS; r++)
+    {
+        readers.emplace_back([&]
+        {
+            uint32_t last = 0;
+            uint64_t localReads = 0;
+
+            while (!done.load(std::memory_order_relaxed))
+            {
+                const snapshot s = lock.load();
+
+                for (const auto word : s.words)
+                {
+                    if (word != s.words[0])
+                    {
+                        torn++;
+                        break;
+                    }
+                }
+
+                if (s.words[0] < last)
+                {
+                    reordered++;
+                }
+
+                last = s.words[0];
+                localReads++;
+            }
+
+            reads += localReads;
+        });
+    }
+
+    uint32_t counter = 0;
+    const auto deadline = std::chrono::steady_clock::now() + DURATION;
+
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            snapshot s;
+            counter++;
+
+            for (auto & word : s.words)
+            {
+                word = counter;
+            }
+
+            lock.store(s);
+        }
+    }
+
+    done = true;
+
+    for (auto & reader : readers)
+    {
+        reader.join();
+    }
+
+    std::printf("%u stores, %llu loads, %llu torn, %llu out of order\n", counter,
+                static_cast<unsigned long long>(reads.load()),
+                static_cast<unsigned long long>(torn.load()),
+                static_cast<unsigned long long>(reordered.load()));
+
+    return torn == 0 && reordered == 0 && lock.sequence() == counter ? 0 : 1;
+}
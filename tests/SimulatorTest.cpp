@@ -0,0 +1,221 @@
+// host test of Jr3Simulator against the decoding path of the sensor thread: the calibration EEPROM is
+// collected from channel 7 and parsed with jr3ParseCalibration(), then each frame set is decoupled one axis
+// at a time as in Jr3Controller::doSensorWork() (eager mode, no filter) and the output is scaled back to
+// N and N*m as explained in the README; Jr3Controller itself runs on Mbed RTOS threads, hence it is not
+// instantiated here; also checks the frame loss accounting and calibration values the firmware can not parse
+
+#include "chrono"
+#include "cmath"
+#include "cstdint"
+#include "cstdio"
+#include "cstring"
+
+#include "Jr3Simulator.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    constexpr int FRAME_SETS = 200000; // about 26 seconds of sensor time
+    constexpr double TOLERANCE = 4.0; // [output counts] raw quantization plus fixed-point rounding
+
+    int failures = 0;
+
+    void check(bool condition, const char * what)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+
+    // within the 16-bit output range, i.e. twice the full scales set below
+    void trajectory(double t, double * wrench)
+    {
+        const double phase = 2.0 * M_PI * 3.0 * t;
+        wrench[0] = 200.0 * std::sin(phase);
+        wrench[1] = -150.0 * std::cos(phase);
+        wrench[2] = 400.0 + 300.0 * std::sin(0.5 * phase);
+        wrench[3] = 4.0 * std::sin(phase + 1.0);
+        wrench[4] = -5.0;
+        wrench[5] = 2.0 * std::cos(2.0 * phase);
+    }
+
+    struct outcome
+    {
+        uint32_t completed;
+        uint32_t discarded;
+        double maxError; // [output counts]
+    };
+
+    // mirrors the frame sequencing, incremental decoupling and output conversion of the sensor thread
+    outcome decode(Jr3Simulator & simulator, const fixed_t * coeffs, const uint16_t * scales, int frameSets)
+    {
+        outcome result {0, 0, 0.0};
+        long long accumulators[6] {};
+        fixed_t decoupled[6];
+        uint8_t expectedChannel = 1; // FORCE_X
+        bool resyncing = false; // the remaining axis frames of a broken frame set are not counted again
+
+        const uint64_t initialSets = simulator.getStatistics().frameSets;
+
+        while (simulator.getStatistics().frameSets - initialSets < static_cast<uint64_t>(frameSets))
+        {
+            const uint32_t frame = simulator.nextFrame();
+            const uint8_t address = (frame & 0x000F0000) >> 16;
+
+            if (address != expectedChannel)
+            {
+                if (expectedChannel != 1 || (address > 1 && address <= 6))
+                {
+                    if (!resyncing)
+                    {
+                        result.discarded++;
+                        resyncing = true;
+                    }
+                }
+                else
+                {
+                    resyncing = false; // voltage or calibration frame between frame sets
+                }
+
+                expectedChannel = 1;
+                continue;
+            }
+
+            resyncing = false;
+
+            if (address == 1)
+            {
+                std::memset(accumulators, 0, sizeof(accumulators));
+            }
+
+            fixedpoint::accumulate_matrix_column<6, 6>(coeffs, address - 1, jr3ToFixedPoint(frame & 0x0000FFFF), accumulators);
+
+            if (address != 6)
+            {
+                expectedChannel++;
+                continue;
+            }
+
+            fixedpoint::accumulators_to_fixed<6>(accumulators, decoupled);
+            expectedChannel = 1;
+            result.completed++;
+
+            // the raw values of this frame set were computed at its first frame
+            double wrench[6];
+            trajectory((simulator.getStatistics().frameSets) * Jr3Simulator::FRAME_SET_PERIOD, wrench);
+
+            for (int i = 0; i < 6; i++)
+            {
+                const int16_t output = static_cast<int16_t>(jr3FromFixedPoint(decoupled[i]));
+                const double expected = wrench[i] * (i < 3 ? 16384.0 : 163840.0) / scales[i];
+                result.maxError = std::fmax(result.maxError, std::fabs(output - expected));
+            }
+        }
+
+        return result;
+    }
+}
+
+int main()
+{
+    // diagonally dominant, with coefficients of all magnitudes down to the smallest one that can be parsed
+    const double matrix[36] = {
+        0.8,     0.02,    -0.01,   0.0,      0.001,    -0.003,
+        -0.015,  0.75,    0.0,     0.002,    0.0,      0.0001,
+        0.05,    -0.04,   0.9,     -0.001,   0.002,    0.0,
+        0.0,     0.001,   0.0,     0.6,      -0.02,    0.01,
+        0.0005,  0.0,     -0.002,  0.03,     0.65,     -1.0 / 65536.0,
+        0.0,     0.0,     0.001,   -0.005,   0.004,    1.0
+    };
+
+    const uint16_t scales[6] = {500, 500, 1000, 50, 50, 60};
+
+    Jr3Simulator simulator(1);
+    check(simulator.setCalibration(matrix, scales), "valid calibration accepted");
+    simulator.setTrajectory(trajectory);
+
+    // calibration EEPROM, one byte per frame set on channel 7, in the same way as the controller collects it
+    uint8_t eeprom[256];
+    bool collected[256] {};
+    int remaining = 256;
+
+    while (remaining > 0)
+    {
+        const uint32_t frame = simulator.nextFrame();
+
+        if ((frame & 0x000F0000) >> 16 == 7)
+        {
+            const uint8_t address = (frame & 0x0000FF00) >> 8;
+
+            if (!collected[address])
+            {
+                eeprom[address] = frame & 0x000000FF;
+                collected[address] = true;
+                remaining--;
+            }
+        }
+    }
+
+    check(std::memcmp(eeprom, simulator.getEeprom(), sizeof(eeprom)) == 0, "EEPROM streamed on channel 7");
+
+    fixed_t coeffs[36];
+    uint16_t parsedScales[6];
+    jr3ParseCalibration(eeprom, coeffs, parsedScales);
+
+    check(std::memcmp(parsedScales, scales, sizeof(scales)) == 0, "full scales parsed");
+
+    bool matrixOk = true;
+
+    for (int i = 0; i < 36; i++)
+    {
+        // the firmware negates coefficients on parsing, mantissas carry 16 bits
+        matrixOk &= std::fabs(-static_cast<double>(coeffs[i]) - matrix[i]) <= std::fabs(matrix[i]) * 0x1p-14 + 0x1p-30;
+    }
+
+    check(matrixOk, "calibration matrix parsed");
+
+    // clean link: every frame set decoded, the requested wrench is reported back
+    const auto start = std::chrono::steady_clock::now();
+    const outcome clean = decode(simulator, coeffs, parsedScales, FRAME_SETS);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    check(clean.completed + 1 >= FRAME_SETS && clean.discarded == 0, "every frame set decoded on a clean link");
+    check(clean.maxError <= TOLERANCE, "wrench reported back on a clean link");
+
+    std::printf("clean link: %u frame sets, max error %.2f counts, %.0f frame sets/s (%.1fx real time)\n",
+                clean.completed, clean.maxError, clean.completed / seconds,
+                clean.completed * Jr3Simulator::FRAME_SET_PERIOD / seconds);
+
+    // lossy link: frame sets with a dropped axis frame are discarded, the remaining ones are still exact
+    simulator.setFaults(1e-3, 0.0);
+    const Jr3Simulator::statistics before = simulator.getStatistics();
+    const outcome lossy = decode(simulator, coeffs, parsedScales, FRAME_SETS);
+    const Jr3Simulator::statistics after = simulator.getStatistics();
+    const uint64_t dropped = after.droppedFrames - before.droppedFrames;
+
+    check(dropped > 0, "frames dropped on a lossy link");
+    check(lossy.discarded <= dropped, "at most one discarded frame set per dropped frame");
+    check(lossy.completed + dropped >= FRAME_SETS - 1, "no frame set lost without a dropped frame");
+    check(lossy.maxError <= TOLERANCE, "wrench reported back on a lossy link");
+
+    std::printf("lossy link: %llu frames dropped, %u frame sets discarded, %u decoded, max error %.2f counts\n",
+                static_cast<unsigned long long>(dropped), lossy.discarded, lossy.completed, lossy.maxError);
+
+    // coefficients the firmware can not parse (a negative or excessive shift in jr3ToFixedPoint()) are rejected
+    double tiny[36];
+    std::memcpy(tiny, matrix, sizeof(tiny));
+    tiny[7] = 1e-6;
+
+    double large[36];
+    std::memcpy(large, matrix, sizeof(large));
+    large[0] = 1.5;
+
+    check(!simulator.setCalibration(tiny, scales), "coefficient below 2^-16 rejected");
+    check(!simulator.setCalibration(large, scales), "coefficient above one rejected");
+    check(std::memcmp(eeprom, simulator.getEeprom(), sizeof(eeprom)) == 0, "calibration kept after a rejection");
+
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
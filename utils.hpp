@@ -2,11 +2,17 @@
 #define __UTILS_HPP__
 
 #include "cstdint"
+#include "cstring"
 #include "fixedpoint/fixed_class.h"
+#include "fixedpoint/fixed_matrix.h"
 
 constexpr int JR3_PRECISION = 15;
 constexpr int FIXED_PRECISION = 30; // pick lower values if saturation occurs
 
+// frames carry 20 bits (4-bit channel address plus 16 bits of data), hence this value can not be
+// confused with a valid frame; returned by readers that give up after a timeout
+constexpr uint32_t JR3_INVALID_FRAME = 0xFFFFFFFF;
+
 using fixed_t = fixedpoint::fixed_point<FIXED_PRECISION>; // (-1, 1]
 
 inline fixed_t jr3ToFixedPoint(uint16_t mantissa, int8_t exponent = 0x00)
@@ -17,10 +23,69 @@ inline fixed_t jr3ToFixedPoint(uint16_t mantissa, int8_t exponent = 0x00)
     return f;
 }
 
+// calibration matrix (row-major, as applied to raw channels) and full scales stored in the sensor EEPROM
+inline void jr3ParseCalibration(const uint8_t * eeprom, fixed_t * coeffs, uint16_t * scales)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            uint16_t mantissa;
+            int8_t exponent;
+
+            memcpy(&mantissa, eeprom + 10 + (i * 20) + (j * 3), sizeof(uint16_t));
+            memcpy(&exponent, eeprom + 12 + (i * 20) + (j * 3), sizeof(int8_t));
+
+            coeffs[(i * 6) + j] = jr3ToFixedPoint(mantissa, exponent);
+        }
+
+        memcpy(scales + i, eeprom + 28 + (i * 20), sizeof(uint16_t));
+    }
+}
+
 inline uint16_t jr3FromFixedPoint(fixed_t f)
 {
-    uint16_t temp = (~f.intValue + 1U) >> (FIXED_PRECISION - JR3_PRECISION);
-    return temp;
+    // saturate instead of wrapping around, values beyond full scale are produced e.g. by the overshoot
+    // of a Butterworth filter after a full-scale step
+    const int32_t temp = static_cast<int32_t>(-static_cast<int64_t>(f.intValue) >> (FIXED_PRECISION - JR3_PRECISION));
+    return static_cast<uint16_t>(temp > INT16_MAX ? INT16_MAX : (temp < INT16_MIN ? INT16_MIN : temp));
+}
+
+// same sign convention as above, but keeping all fractional bits: divide by 2^15 to obtain the 16-bit value;
+// values beyond full scale are kept as they are (they fit), except for the one that can not be negated
+inline int32_t jr3FromFixedPointExtended(fixed_t f)
+{
+    return f.intValue == INT32_MIN ? INT32_MAX : -f.intValue;
+}
+
+// values at (t0 + elapsed), given two samples taken at t0 and (t0 + span); clamped to the first sample
+// before t0, and to the second one from (t0 + span) onwards (no extrapolation); the weight is expressed
+// in Q16, hence the result is exact up to 2^-16 of the difference between both samples
+inline void interpolateLinear(const fixed_t * previous, const fixed_t * current, int32_t span, int32_t elapsed,
+                              fixed_t * out, int count)
+{
+    if (span <= 0 || elapsed >= span)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            out[i] = current[i];
+        }
+
+        return;
+    }
+
+    if (elapsed < 0)
+    {
+        elapsed = 0;
+    }
+
+    const int32_t weight = (static_cast<uint64_t>(elapsed) << 16) / span;
+
+    for (int i = 0; i < count; i++)
+    {
+        const int64_t delta = static_cast<int64_t>(current[i].intValue) - previous[i].intValue;
+        out[i].intValue = previous[i].intValue + static_cast<int32_t>((delta * weight) >> 16);
+    }
 }
 
 #endif // __UTILS_HPP__